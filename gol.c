@@ -8,12 +8,113 @@
     the name of the file and then a value of 0, 1 or 2. With 0 being no visual, 1 being
    the ASCII visual, and 3 being the VISI visual. */
 /*
- * To run:
+ * To run (after the file name and output mode come num_threads,
+ * para_mode and print_info; para_mode 0 splits the board into row strips,
+ * 1 into column strips and 2 into 2D blocks walked in L2-sized tiles, with
+ * every thread pinned to a core and first-touching its own block; 3 cuts
+ * the board into small tiles that idle threads steal from busy ones):
  * ./gol file1.txt  0  # run with config file file1.txt, do not print board
  * ./gol file1.txt  1  # run with config file file1.txt, ascii animation
  * ./gol file1.txt  2  # run with config file file1.txt, ParaVis animation
+ * ./gol - 0 4 0 0 --random 8192x8192 --density 0.3 --seed 7 --iters 100
+ *                     # run a random 8192 x 8192 board, no input file
+ *
+ * The input file may be the plain text format (rows cols iters
+ * num_alive, then one "row col" per live cell), an RLE pattern, or the
+ * binary bitmap format described above open_input(); it is memory-mapped
+ * and parsed in place.
+ *
+ * Optional flags may follow the five required arguments:
+ *   --iters N          run N rounds, whatever the input file says (RLE
+ *                      files have no round count, so they need this)
+ *   --size RxC         put an RLE pattern in the middle of an R x C board
+ *   --random RxC       instead of reading a file (give - as the input
+ *                      file), make an R x C board with every cell alive
+ *                      with chance --density, from --seed; each thread
+ *                      fills the part of the board it computes (dense
+ *                      and bitpack engines, needs --iters)
+ *   --density P        fraction of the --random board alive (default 0.5)
+ *   --seed N           seed of the --random board (default 1): the same
+ *                      seed, size and density always give the same board,
+ *                      whatever the engine, threads or para_mode
+ *   --resume FILE      read the board from checkpoint FILE instead of the
+ *                      input file and carry on from its generation
+ *   --checkpoint FILE  write checkpoints of the board to FILE (dense and
+ *                      bitpack engines), in the binary board format
+ *   --checkpoint-every N     ... every N generations
+ *   --checkpoint-secs T      ... every T seconds
+ *   --report-json FILE write the performance report to FILE as JSON
+ *   --report-csv FILE  append the performance report to FILE as a CSV row
+ *   --perf             with print_info 1, also read each thread's hardware
+ *                      counters (cycles, instructions, cache misses)
+ *   --engine dense     one int per cell (default)
+ *   --engine bitpack   64 cells per uint64_t word, word-parallel kernel
+ *   --engine hashlife  hash-consed quadtree with memoized futures; runs
+ *                      on an unbounded plane, single-threaded, and only
+ *                      draws the first and last generation
+ *   --engine sparse    only the live cells, in a hash table; memory and
+ *                      time follow the population, not rows x cols;
+ *                      single-threaded
+ *   --hashlife-nodes N collect unreachable HashLife nodes once more than
+ *                      N are in use (default 4194304)
+ *   --simd auto|scalar|sse2|avx2|avx512
+ *                      row kernel for the bitpack engine (default: the
+ *                      widest one the CPU supports)
+ *   --world torus      edges wrap around to the opposite side (default)
+ *   --world bounded    cells past the edges are always dead
+ *                      (not with --engine hashlife, which has no edges)
+ *   --barrier pthread  threads meet at a pthread_barrier_t between
+ *                      generations (default)
+ *   --barrier spin     threads meet at a sense-reversing spin barrier
+ *   --rule RULE        run the Life-like rule RULE, e.g. B36/S23 or
+ *                      23/36 (default B3/S23, Conway's Life)
+ *   --population FILE  write "generation live_cells" to FILE for every
+ *                      generation, starting with generation 0 (with
+ *                      --active, a third column has the tiles skipped)
+ *   --active           only recompute tiles that changed in the previous
+ *                      generation or border one that did
+ *   --ascii-diff       in ASCII mode, only redraw the cells that changed
+ *                      since the last frame
+ *   --async-render     draw from a separate thread instead of in the
+ *                      generation loop: the simulation runs at full speed
+ *                      and the newest generation is drawn --fps times a
+ *                      second, skipping the ones in between
+ *   --fps N            frames a second for --async-render (default 10)
+ *   --detect-cycles    stop as soon as the board repeats one of the last
+ *                      --max-period generations (it died out, became a
+ *                      still life or an oscillator) and print the generation
+ *                      and period it stabilized at; the live cell count is
+ *                      still the one after all the rounds, read off the
+ *                      cycle (dense and bitpack engines)
+ *   --max-period N     longest period --detect-cycles looks for (default 64)
+ *   --procs N          bitpack engine, no output: split the board into N
+ *                      row blocks, each run by its own process with one
+ *                      thread, that swap their edge rows every generation
+ *                      over local sockets (num_threads must be 1)
+ *   --temporal K|auto  bitpack engine, para_mode 0, no output: advance the
+ *                      board K generations per pass over memory, in bands
+ *                      of rows that stay in L2; auto tries a few K at the
+ *                      start and keeps the fastest
+ *   --hugetlb          put the boards in reserved huge pages (MAP_HUGETLB,
+ *                      see /proc/sys/vm/nr_hugepages) instead of asking
+ *                      for transparent ones, if there are enough
+ *
+ * With print_info 1, the dense and bitpack engines print a table at the
+ * end of what each thread did: cells computed, time computing, time
+ * waiting at the barriers, and which partition was the straggler.
+ *
+ * ./gol --bench [options]  runs the benchmark suite instead: synthetic
+ * boards across sizes, engines, thread counts and para_modes, repeated,
+ * reporting cell updates per second; see run_bench() for its options.
+ *
+ * ./gol --batch LIST|DIR [options]  runs many independent boards instead:
+ * every input file named in LIST (one path per line) or found in DIR is
+ * run to the end on its own by one of a pool of worker threads, which
+ * reuse their boards from one file to the next, and the final population
+ * and timing of every board is printed; see run_batch() for its options.
  *
  */
+#define _GNU_SOURCE
 #include <pthreadGridVisi.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -22,6 +123,20 @@
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <errno.h>
+#include <dirent.h>
+#include <math.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include "colors.h"
 #include "graphics.h"
 
@@ -38,17 +153,391 @@
 //#define SLEEP_USECS  (1000000)
 #define SLEEP_USECS    (100000)
 
+/* --async-render: the mailbox index bit that says the snapshot in it
+ * hasn't been taken by the render thread yet */
+#define RENDER_FRESH   (4u)
+
+/* Board representations (engines) the simulation can run with */
+#define ENGINE_DENSE    (0)   // one int per cell, per-cell kernel
+#define ENGINE_BITPACK  (1)   // 64 cells per uint64_t, word-parallel kernel
+#define ENGINE_HASHLIFE (2)   // hash-consed quadtree, memoized futures
+#define ENGINE_SPARSE   (3)   // list of live cells, hashed neighbor counts
+
+/* Sparse engine: an unused slot of the count table, the smallest table,
+ * and the count bit that marks a cell that is alive now */
+#define SPARSE_EMPTY       (~(uint64_t)0)
+#define SPARSE_MIN_TABLE   (1 << 10)
+#define SPARSE_ALIVE_SHIFT (4)
+#define SPARSE_ALIVE       (1 << SPARSE_ALIVE_SHIFT)
+
+/* HashLife node cache: default node limit before a collection, nodes
+ * carved per allocation, first hash table size and deepest tree level */
+#define HL_DEFAULT_NODES (1 << 22)
+#define HL_BLOCK_NODES   (1 << 16)
+#define HL_MIN_TABLE     (1 << 16)
+#define HL_MAX_LEVEL     (63)
+
+/* Number of cells stored in one word of the bit-packed board */
+#define BITS_PER_WORD   (64)
+
+/* Row kernels for the interior words of the bit-packed board */
+#define SIMD_AUTO     (-1)  // pick the widest one the CPU supports
+#define SIMD_SCALAR   (0)
+#define SIMD_SSE2     (1)
+#define SIMD_AVX2     (2)
+#define SIMD_AVX512   (3)
+
+/* A Life-like rule is two masks of 9 bits, birth and survival: bit k is
+ * set when a cell with k live neighbors is born / survives */
+#define RULE_MASK(k)  (1u << (k))
+
+/* Topologies of the world at the edges of the board */
+#define WORLD_TORUS     (0)   // edges wrap around to the opposite side
+#define WORLD_BOUNDED   (1)   // everything past the edges is dead
+
+/* Barriers the threads can meet at between generations */
+#define BARRIER_PTHREAD (0)   // pthread_barrier_t, sleeps in the kernel
+#define BARRIER_SPIN    (1)   // sense-reversing spin barrier
+
+/* Ways the board can be split between the threads (para_mode) */
+#define PARA_ROWS       (0)   // strips of whole rows
+#define PARA_COLS       (1)   // strips of whole columns
+#define PARA_TILES      (2)   // 2D blocks, walked in L2-sized tiles
+#define PARA_STEAL      (3)   // small tiles in per-thread work-stealing deques
+
+/* Work-stealing mode cuts the board into at least this many tiles per thread */
+#define STEAL_TILES_PER_THREAD (16)
+
+/* L2 size to size tiles for when the system won't report one */
+#define DEFAULT_L2_BYTES (1 << 20)
+
+/* Size of the tiles --active tracks changes in (columns are cells; on the
+ * bit-packed board a tile is one word wide) */
+#define ACTIVE_TILE_ROWS (32)
+#define ACTIVE_TILE_COLS (64)
+
+/* Formats of the input file */
+#define INPUT_TEXT      (0)   // rows cols iters num_alive, then row col pairs
+#define INPUT_RLE       (1)   // standard run-length encoded pattern
+#define INPUT_BINARY    (2)   // struct gol_bin_header, then a bit-packed board
+#define INPUT_RANDOM    (3)   // no file: --random, filled by the threads
+
+/* --random: the density is a fraction in 1/2^RANDOM_BITS steps, and a
+ * word of 64 cells takes up to RANDOM_BITS random words to make */
+#define RANDOM_BITS     (16)
+
+/* States of a checkpoint snapshot buffer */
+#define SNAP_FREE       (0)   // nothing in it
+#define SNAP_FILLING    (1)   // the threads are copying the board into it
+#define SNAP_READY      (2)   // waiting for the writer thread
+#define SNAP_WRITING    (3)   // the writer thread is writing it out
+
+/* First eight bytes of a binary board file */
+#define GOL_BIN_MAGIC   "GOLBIN1"
+
+/* Generation latency histogram: log-scale buckets LATENCY_STEP apart,
+ * starting at LATENCY_FLOOR seconds (1% steps from 10ns cover hours) */
+#define LATENCY_BUCKETS (3000)
+#define LATENCY_FLOOR   (1e-8)
+#define LATENCY_STEP    (1.01)
+
+/* --temporal: the value of --temporal auto, the deepest block it tries,
+ * and the least rows in a band for every row of halo on one side */
+#define TEMPORAL_AUTO       (-1)
+#define TEMPORAL_MAX_DEPTH  (16)
+#define TEMPORAL_MIN_BAND   (4)
+
+/* --procs: the most processes the board can be split across */
+#define PROCS_MAX           (1024)
+
+/* --detect-cycles: the longest period looked for by default */
+#define CYCLE_DEFAULT_PERIOD (64)
+
+/* --bench: the synthetic board patterns, the most values a list option
+ * can have, and about how many cell updates each run does */
+#define BENCH_PATTERNS  (6)
+#define BENCH_MAX_LIST  (16)
+#define BENCH_WORK      (1LL << 27)
+
+/* ASCII renderer: room for the round and live cell lines and the escape
+ * codes around them, and the longest cursor move plus a cell */
+#define SCREEN_EXTRA    (128)
+#define SCREEN_MOVE_LEN (32)
+
+/* Size of a cache line; per-thread counters are padded out to one */
+#define CACHE_LINE      (64)
+
+/* Size of a huge page: boards at least this big start in one. Each board
+ * after the first starts ARENA_SKEW bytes further into its huge page than
+ * the one before (wrapping after ARENA_SKEWS boards): with huge pages the
+ * same cell of two boards is otherwise the same distance from a 2 MB
+ * boundary, so it lands in the same cache set, and the kernels, which read
+ * one board where they write the other, run 2-3 times slower. */
+#define HUGE_PAGE       (2 * 1024 * 1024)
+#define ARENA_SKEW      (17 * CACHE_LINE)
+#define ARENA_SKEWS     (4)
+
+/* Spins a waiting thread makes on the spin barrier before yielding the CPU */
+#define SPIN_YIELD_EVERY (1024)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_SIMD (1)
+#endif
+
 /* A global variable to keep track of the number of live cells in the
  * world (this is the ONLY global variable you may use in your program)
  */
-static int total_live = 0;
-struct timeval start_time, stop_time;
+static long long total_live = 0;
 
 static int rt = 0;
 static int sr_count = 0;
 
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* The barrier all the threads wait at twice per generation: once when
+ * their part of next is written, and once when the designated thread has
+ * refreshed the halo and drawn the board. One of these is shared by every
+ * thread through its copy of struct gol_data.
+ */
+struct gol_barrier {
+    int kind;                    // BARRIER_PTHREAD or BARRIER_SPIN
+    int num_threads;
+    pthread_barrier_t pbarrier;  // used by BARRIER_PTHREAD
+    int count;                   // spin barrier: threads yet to arrive
+    int sense;                   // spin barrier: flips when all arrive
+};
+
+/* The live cells one thread counted in its partition in the last
+ * generation, plus its running work-stealing stats. Each thread has its
+ * own, a cache line apart from the others, so counting never bounces a line
+ * between cores; thread 0 adds the live counts up once per generation after
+ * the barrier.
+ */
+struct gol_counter {
+    long long live;
+    long long old_live;  // --active: live cells the computed tiles had before
+    long long skipped;   // --active: quiescent tiles skipped this generation
+    long long tiles;   // tiles this thread computed, all generations
+    long long steals;  // how many of those it took from another thread
+    uint64_t hash;     // --detect-cycles: board hash change this generation
+    char pad[CACHE_LINE - 5 * sizeof(long long) - sizeof(uint64_t)];
+} __attribute__((aligned(CACHE_LINE)));
+
+/* What one thread did over the whole run, for the print_info table.
+ * Each thread writes only its own, and thread 0 reads them after the join.
+ */
+#define PERF_EVENTS (3)   // cycles, instructions, cache misses
+struct gol_thread_stats {
+    long long cells;     // cells computed, all generations
+    double compute;      // seconds computing
+    double wait;         // seconds waiting at the two barriers
+    double serial;       // thread 0: seconds in the serial step
+    int perf_fd;         // --perf: counter group leader, or -1
+    int perf_member[PERF_EVENTS - 1];
+    int perf_ok;         // the counters below were read
+    long long cycles;
+    long long instructions;
+    long long cache_misses;
+} __attribute__((aligned(CACHE_LINE)));
+
+/* One thread's queue of tiles for the current generation in para_mode 3.
+ * Tiles are only ever taken out during a generation, so the queue is just
+ * the range [head, tail) of tile numbers, packed into one word: the owner
+ * takes tiles off the head and thieves take them off the tail, each with a
+ * compare-and-swap of the whole word.
+ */
+struct gol_deque {
+    uint64_t range;    // head in the low 32 bits, tail in the high 32 bits
+    char pad[CACHE_LINE - sizeof(uint64_t)];
+} __attribute__((aligned(CACHE_LINE)));
+
+/* Header of a binary board file. It is 64 bytes, so the board words that
+ * follow it are cache-line aligned when the file is mapped. */
+struct gol_bin_header {
+    char magic[8];        // GOL_BIN_MAGIC
+    int32_t rows;
+    int32_t cols;
+    int32_t iters;        // rounds to run
+    int32_t reserved;
+    int64_t generation;   // generation the board is at
+    int64_t population;   // live cells on the board
+    char pad[24];
+};
+
+/* An input file mapped into memory, while it is being read */
+struct gol_input {
+    char *buf;            // the mapped file
+    size_t len;
+    size_t pos;           // where parsing is up to
+    int format;           // INPUT_TEXT, INPUT_RLE or INPUT_BINARY
+    int words_per_row;    // binary: words in one row of the board
+    int width, height;    // RLE: size of the pattern
+    size_t body;          // RLE: where the runs start
+};
+
+/* Generation latencies, as a histogram so that memory doesn't grow with
+ * the number of generations */
+struct gol_latency {
+    long long count;
+    double min, max;
+    long long buckets[LATENCY_BUCKETS];
+};
+
+/* Where the time went; thread 0 is the only one that writes to it */
+struct gol_timing {
+    double load;          // reading the input and setting up the boards
+    double run;           // everything after that, until the last round
+    double compute;       // generations, including the barriers
+    double output;        // drawing the board
+    struct gol_latency latency;  // of each generation, without output
+};
+
+/* The ASCII renderer's frame buffer and what is on the screen now */
+struct gol_screen {
+    char *frame;            // the next frame, built up before one write()
+    size_t full_len;        // size of frame: enough for the whole board
+    unsigned char *shown;   // rows * cols, 1 where the screen shows '@'
+    int drawn;              // a frame has been drawn since the clear
+};
+
+/* --detect-cycles: the hash of the board and of the last generations.
+ * The hash is the XOR of a random key per live cell (Zobrist hashing; for
+ * bitpack, a key per word and its value), so the threads keep it up to
+ * date by XORing in the keys of just the cells (words) that changed;
+ * thread 0 looks for it among the last max_period generations after
+ * every one. */
+struct gol_cycles {
+    uint64_t hash;          // of the current board
+    int max_period;         // longest period looked for
+    uint64_t *hashes;       // ring: generation g's hash at g % (max_period + 1)
+    long long *pops;        // ... and its live cells
+    long long first;        // first generation in the ring
+    long long generation;   // generation the repeat was found at
+    long long stable_gen;   // first generation of the cycle, or -1
+    int period;             // its period
+    int stop;               // set by thread 0, read by every thread after the barrier
+};
+
+/* --temporal: how deep the blocks are. Thread 0 changes k only in the
+ * serial step, and the other threads read it after the barrier. */
+struct gol_temporal {
+    int k;               // generations per block now
+    int k_max;           // the scratch boards are sized for this
+    int band_rows;       // rows in a band, not counting the halo
+    int tuning;          // auto: still timing the depths
+    int trial;           // auto: blocks timed so far, -1 while warming up
+    double best;         // auto: least seconds per generation so far
+    int best_k;          // auto: the depth that took it
+};
+
+/* One mapping that holds the boards, the partition tables and the
+ * per-thread state of a run, released at exit with one munmap. Boards of
+ * a huge page or more are carved from the bottom, each starting on a huge
+ * page; everything else comes off the top, a cache line at a time, so the
+ * small pieces main() writes never share a page with a board. This struct
+ * is the last thing in the mapping. */
+struct gol_arena {
+    char *base;           // the mapping
+    size_t size;          // its length
+    size_t low;           // the first free byte at the bottom
+    size_t high;          // the first byte taken at the top
+    int boards;           // pieces taken from the bottom
+    int hugetlb;          // 1 if it is in reserved huge pages
+};
+
+/* --procs: one direction of a process's link to a neighbor block, while a
+ * halo row is on its way across */
+struct gol_halo {
+    int fd;               // the socket to the neighbor, or -1 at a bounded edge
+    const char *send;     // our edge row
+    size_t sent;
+    char *recv;           // our halo row on that side
+    size_t received;
+};
+
+/* --procs: what one process sends back to the parent at the end */
+struct gol_proc_result {
+    int rank;
+    long long live;       // live cells in its block after the last round
+    double compute;       // seconds computing
+    double wait;          // seconds waiting for halo rows
+};
+
+/* A copy of the board, bit-packed, on its way to the checkpoint file */
+struct gol_snapshot {
+    uint64_t *words;
+    long long generation;
+    long long population;
+    int state;            // SNAP_FREE .. SNAP_WRITING, under the lock
+};
+
+/* The checkpoint writer thread and its two snapshot buffers */
+struct gol_checkpointer {
+    const char *path;
+    long long every;      // checkpoint every this many generations, or 0
+    double secs;          // checkpoint every this many seconds, or 0
+    struct timespec last; // when the last checkpoint was taken
+    int rows, cols, iters, words_per_row;
+    struct gol_snapshot snap[2];
+    struct gol_snapshot *filling;  // claimed this generation, or NULL
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  // signaled when a snapshot is READY, or to quit
+    int quit;
+    long long written, skipped, failed;
+};
+
+/* One node of the HashLife quadtree: a square of 2^level x 2^level cells.
+ * Level 0 nodes are single cells; every other node is made of four
+ * quadrants and exists once per distinct contents.
+ */
+struct hl_node {
+    struct hl_node *nw, *ne, *sw, *se;  // quadrants, unused for a cell
+    struct hl_node *result;  // center half, 2^step_log generations later
+    struct hl_node *next;    // hash chain, or free list
+    long long pop;           // live cells in the square
+    int level;
+    int mark;                // reachable, during a collection
+};
+
+/* A bitpack row kernel: advances interior words w0..w1 of a bit-packed
+ * row under the rule birth / survive and returns the live count */
+typedef int (*bitpack_kernel_fn)(const uint64_t *up, const uint64_t *mid,
+        const uint64_t *down, uint64_t *out, int w0, int w1,
+        unsigned birth, unsigned survive);
+
+/* The HashLife node cache and the current root */
+struct hl_universe {
+    struct hl_node **table;  // hash table of nodes by their quadrants
+    size_t table_size;       // buckets, a power of two
+    size_t count;            // nodes in the table
+    size_t max_nodes;        // collect garbage once count passes this
+    struct hl_node *free_list;
+    struct hl_node **blocks; // every block of nodes allocated
+    int num_blocks;
+    struct hl_node *leaf[2];  // the dead and the live cell
+    struct hl_node *empty[HL_MAX_LEVEL];  // all-dead node of each level
+    struct hl_node *root;
+    long long row0, col0;    // board coordinates of the root's top-left
+    int step_log;            // memoized results advance 2^step_log gens
+    int collections;         // collections run so far
+    size_t freed;            // nodes freed by them
+    unsigned char rule_next[2][9];  // the rule, as in struct gol_data
+};
+
+/* The sparse engine's world: the live cells, and the table their neighbor
+ * counts are gathered in each generation */
+struct sparse_world {
+    uint64_t *live;          // row << 32 | col of every live cell
+    size_t num_live;
+    size_t live_cap;
+    uint64_t *keys;          // count table: a cell, or SPARSE_EMPTY
+    unsigned char *counts;   // live neighbors, plus SPARSE_ALIVE if alive
+    size_t table_cap;        // slots, a power of two
+    int sorted;              // live is in order, for lookups
+    unsigned char rule_next[2][9];  // the rule, as in struct gol_data
+};
+
 /* This struct represents all the data you need to keep track of your GOL
  * simulation.  Rather than passing individual arguments into each function,
  * we'll pass in everything in just one of these structs.
@@ -62,13 +551,55 @@ struct gol_data {
     int iters; // number of iterations to run the gol simulation
     int output_mode; // set to:  OUTPUT_NONE, OUTPUT_ASCII, or OUTPUT_VISI
     int num_cells;
-    int num_alive_cells;
-    int* current;
+    long long num_alive_cells;
+    int* current;        // dense board: (rows+2) x (cols+2) with a halo
     int* next;
+    int stride;          // dense board: ints in one padded row (cols + 2)
+    int world;           // WORLD_TORUS or WORLD_BOUNDED
+    int engine;          // ENGINE_DENSE or ENGINE_BITPACK
+    int words_per_row;   // bit-packed board: words in one row
+    uint64_t last_mask;  // bit-packed board: valid bits of the last word
+    uint64_t *bcurrent;  // bit-packed board: bit j%64 of word j/64 is col j
+    uint64_t *bnext;
+    uint64_t *bzero;     // bit-packed board: an all-dead row (bounded world)
+    uint64_t *mapped_board;  // bit-packed board mapped from the input, or NULL
+    void *input_map;     // the mapping mapped_board is in
+    size_t input_map_len;
+    long long generation0;   // generation the input board is at
+    struct gol_checkpointer *checkpoint;  // --checkpoint, or NULL
+    struct gol_cycles *cycles;  // --detect-cycles, or NULL; shared
+    struct gol_temporal *temporal;  // --temporal, or NULL; shared
+    int procs;           // --procs: processes the board is split across, or 0
+    struct gol_arena *arena;  // the boards and the per-thread state
+    int random_fill;     // --random: the threads make the board
+    uint32_t random_density;  // --random: chance a cell is alive, in 1/2^RANDOM_BITS
+    uint64_t random_seed;     // --random: the seed
+    struct gol_screen *screen;  // ASCII mode's renderer, or NULL
+    struct gol_render *render;  // --async-render's render thread, or NULL
+    int async_render;           // --async-render
+    int visi_dirty;             // ParaVis: workers repaint the cells they change
+    int fps;                    // --fps: frames a second for --async-render
+    int ascii_diff;             // --ascii-diff: only redraw changed cells
+    struct gol_timing *timing;  // shared by all the threads
+    const char *report_json;    // --report-json FILE, or NULL
+    const char *report_csv;     // --report-csv FILE, or NULL
+    int simd;            // SIMD_SCALAR .. SIMD_AVX512, chosen at startup
+    // advances interior words w0..w1 of a bit-packed row, returns live count
+    bitpack_kernel_fn bitpack_kernel;
+    unsigned rule_birth;     // --rule: neighbor counts a dead cell is born with
+    unsigned rule_survive;   // --rule: neighbor counts a live cell survives with
+    unsigned char rule_next[2][9];  // the rule as a table: [alive][neighbors]
     int rounds;
     int num_threads;
     int para_mode;
     int print_info;
+    int barrier_kind;    // BARRIER_PTHREAD or BARRIER_SPIN
+    struct gol_barrier *barrier;  // shared by all the threads
+    int barrier_sense;   // this thread's sense for the spin barrier
+    struct gol_counter *live_counts;  // one per thread, shared
+    struct gol_thread_stats *thread_stats;  // one per thread with print_info 1, else NULL
+    int perf;            // --perf: read hardware counters too
+    FILE *population_file;  // per-generation live cells, or NULL
     //pthread_t thread_id;
     int id;
     int rows_per_thread;
@@ -76,11 +607,81 @@ struct gol_data {
     // int end_row;
     int **row_partition_info;
     int **col_partition_info;
+    int **tile_partition_info;  // para_mode 2: row0, row1, col0, col1
+    int tile_rows;       // rows in one tile a thread works through at a time
+    int tile_cols;       // columns (words, for bitpack) in one tile
+    int *initial_cells;  // para_mode 2: x, y pairs placed after first touch
+    int tiles_down;      // para_mode 3: tiles in one column of tiles
+    int tiles_across;    // para_mode 3: tiles in one row of tiles
+    struct gol_deque *deques;  // para_mode 3: one per thread, shared
+    int active;          // 1 to skip tiles with no changes around them
+    int active_down;     // --active: tiles in one column of tiles
+    int active_across;   // --active: tiles in one row of tiles
+    unsigned char *changed;       // --active: tiles changed last generation
+    unsigned char *changed_next;  // --active: tiles changed this generation
+    long long hl_max_nodes;  // HashLife: node limit before a collection
+    struct hl_universe *hl;  // HashLife: the universe, or NULL
+    struct sparse_world *sparse;  // sparse engine: the world, or NULL
     /* fields used by ParaVis library (when run in OUTPUT_VISI mode). */
     visi_handle handle;
     color3 *image_buff;
 };
 
+/* The final state of one --batch board and where its time went */
+struct gol_batch_result {
+    int rows, cols;
+    long long generations;  // generations run
+    long long population;   // live cells after the last one
+    long long stable_gen;   // --detect-cycles: where it stabilized, or -1
+    int period;             // ... and with what period
+    double load;            // reading the file and setting up the board
+    double run;             // running the generations
+};
+
+/* One --batch worker thread and its boards. The boards are kept from one
+ * job to the next and only reallocated when a bigger board comes along. */
+struct gol_batch_worker {
+    struct gol_batch *batch;
+    int id;
+    pthread_t thread;
+    struct gol_data data;   // the job being run, boards from the pool below
+    int *current, *next;    // dense boards
+    size_t cells;           // ints in each dense board
+    uint64_t *bcurrent, *bnext, *bzero;  // bit-packed boards
+    size_t words;           // words in each bit-packed board
+    size_t zero_words;      // words in bzero
+    long long allocs;       // times a board had to be (re)allocated
+    struct gol_counter counter;  // the job's board hash changes
+    struct gol_cycles cycles;    // --detect-cycles, ring kept between jobs
+};
+
+/* The --batch jobs, shared by the workers */
+struct gol_batch {
+    char **paths;           // the input files
+    int num_paths;
+    int next_job;           // the next path to hand out, taken atomically
+    int iters;              // --iters, or -1 for each file's own
+    int max_period;         // --detect-cycles: longest period, or 0 for off
+    struct gol_batch_result *results;  // one per path
+    struct gol_data proto;  // engine, world and rule every job starts from
+};
+
+/* The render thread and its triple buffer of snapshots (--async-render) */
+struct gol_render {
+    struct gol_snapshot snap[3];
+    int back;                 // the producer's buffer
+    int front;                // the render thread's buffer
+    unsigned int middle;      // the mailbox: buffer index | RENDER_FRESH
+    int done;                 // the run is over
+    int frame_usecs;          // time between frames
+    double last_publish;      // when the producer last published
+    long long published;      // snapshots handed over
+    long long frames;         // snapshots drawn
+    long long dropped;        // snapshots replaced before they were drawn
+    pthread_t thread;
+    struct gol_data view;     // a bitpack board that reads the snapshot
+};
+
 
 /****************** Function Prototypes **********************/
 /* the main gol game playing loop (prototype must match this) */
@@ -89,25 +690,235 @@ void* play_gol(void* args);
 /* init gol data from the input file and run mode cmdline args */
 int init_game_data_from_args(struct gol_data *data, int argc, char **argv);
 
+// maps the input file and reads its header
+void open_input(struct gol_data *data, const char *path, struct gol_input *in);
+
+// places the live cells of the input on the board
+void read_cells(struct gol_data *data, struct gol_input *in);
+
+// unmaps the input file once the board no longer needs it
+void close_input(struct gol_data *data, struct gol_input *in);
+
+// puts one live cell on the board (or on the list of initial cells)
+void place_cell(struct gol_data *data, int x, int y, long long i);
+
+// returns the monotonic clock in seconds
+double timing_now(void);
+
+// records one generation's latency
+void latency_add(struct gol_latency *lat, double secs);
+
+// returns the q-th quantile of the recorded latencies
+double latency_quantile(struct gol_latency *lat, double q);
+
+// prints the performance report (and writes it as JSON/CSV if asked)
+void print_report(struct gol_data *data);
+
+// writes one synthetic benchmark board in the binary format
+void bench_board(const char *path, int pattern, int size, int iters);
+
+// runs this program once on a board and returns its cell updates per second
+double bench_run(const char *board, int engine, int threads, int mode, const char *report);
+
+// the --bench mode: runs the whole benchmark suite
+int run_bench(int argc, char **argv);
+
+// the --batch mode: runs many boards, each on its own, on a pool of threads
+int run_batch(int argc, char **argv);
+
+// opens and starts the calling thread's hardware counters (--perf)
+void perf_open(struct gol_thread_stats *stats);
+
+// stops, reads and closes the calling thread's hardware counters
+void perf_close(struct gol_thread_stats *stats);
+
+// prints the per-thread table and the slowest thread
+void print_thread_stats(struct gol_data *data);
+
+// starts the checkpoint writer thread (--checkpoint)
+void checkpoint_start(struct gol_data *data);
+
+// hands the current board to the writer if a checkpoint is due
+void checkpoint_maybe(struct gol_data *data, long long generation);
+
+// packs the calling thread's rows into the claimed snapshot
+void checkpoint_pack(struct gol_data *data, int id);
+
+// hands the filled snapshot to the writer thread
+void checkpoint_publish(struct gol_data *data);
+
+// waits for outstanding checkpoints and stops the writer thread
+void checkpoint_stop(struct gol_data *data);
+
+// hashes the board and starts the generation history (--detect-cycles)
+void cycles_start(struct gol_data *data, struct gol_cycles *cycles);
+
+// returns the board hash change from cells of a row that differ in next
+uint64_t row_hash(struct gol_data *data, int row, int col0, int col1);
+
+// records a generation, returns 1 if it repeats one of the last ones
+int cycles_record(struct gol_cycles *cycles, long long generation, long long live);
+
+// returns the live cells at a generation past the start of the cycle
+long long cycles_population(struct gol_cycles *cycles, long long generation);
+
+// packs the current board 64 cells to a word
+void pack_board(struct gol_data *data, uint64_t *words);
+
+// packs rows row0..row1 of the current board
+void pack_rows(struct gol_data *data, uint64_t *words, int row0, int row1);
+
+// repaints the ParaVis pixels of the cells that changed in a rectangle
+void paint_tile(struct gol_data *data, int row0, int row1, int col0, int col1);
+
+// starts the render thread (--async-render)
+void render_start(struct gol_data *data);
+
+// hands the board to the render thread if a frame is due
+void render_publish(struct gol_data *data, long long generation, int force);
+
+// waits for the last frame and stops the render thread
+void render_stop(struct gol_data *data);
+
 // A mostly implemented function, but a bit more for you to add.
 /* print board to the terminal (for OUTPUT_ASCII mode) */
-void print_board(struct gol_data *data, int round);
+void print_board(struct gol_data *data, long long round);
+
+// draws one frame of the board with the given round and live cells
+void draw_frame(struct gol_data *data, long long round, long long live);
+
+// sets up the frame buffer print_board() draws into
+void screen_init(struct gol_data *data);
+
+// frees the frame buffer
+void screen_free(struct gol_data *data);
 
 // makes the board
 void make_board(int *arr, int rows, int cols);
 
+// copies the edges of the dense board into its halo (torus world)
+void refresh_halo(struct gol_data *data, int *board);
+
+// advances columns c0..c1 of one row of the dense board
+int dense_step_row(struct gol_data *data, int row, int c0, int c1);
+
 // counts the number of alive neighboring cells
 int count_alive(struct gol_data *data, int x_axis, int y_axis);
 
-// changes the status of a dead cell to alive
-void make_alive(struct gol_data *data, int x_axis, int y_axis, int alive);
+// changes the status of a dead cell to alive, returns the new state
+int make_alive(struct gol_data *data, int x_axis, int y_axis, int alive);
 
 // changes the colors for the VISI visual output
 void update_colors(struct gol_data* data);
 
+// returns 1 if cell (x_axis, y_axis) of the current board is alive
+int get_cell(struct gol_data *data, int x_axis, int y_axis);
+
+// advances words w0..w1 of one row of the bit-packed board
+int bitpack_step_row(struct gol_data *data, int row, int w0, int w1);
+
+// advances words w0..w1 of the row mid into out, whatever board it is in
+int bitpack_step_words(struct gol_data *data, const uint64_t *up, const uint64_t *mid,
+        const uint64_t *down, uint64_t *out, int w0, int w1);
+
+// advances a thread's rows several generations at once, a band at a time
+long long temporal_block(struct gol_data *data, int row0, int row1, int k, uint64_t *scratch);
+
+// runs all the rounds on row blocks in separate processes (--procs)
+void play_procs(struct gol_data *data);
+
+// picks the band height and the deepest block for --temporal
+void temporal_init(struct gol_data *data, int k);
+
+// after a block, tries the next depth or settles on the fastest (--temporal auto)
+void temporal_tune(struct gol_data *data, int k, double secs);
+
+// picks the bit-packed row kernel for data->simd, the rule and the running CPU
+void select_bitpack_kernel(struct gol_data *data);
+
+// parses a rulestring into birth and survival masks
+int parse_rule(const char *str, unsigned *birth, unsigned *survive);
+
 void* play_gol_thread(void* arg);
-int** row_partition(int rows, int cols, int num_threads);
-int** col_partition(int rows, int cols, int num_threads);
+
+// sets up a barrier of the given kind for num_threads threads
+void barrier_init(struct gol_barrier *barrier, int kind, int num_threads);
+
+// blocks until all the threads have reached the barrier
+void barrier_wait(struct gol_barrier *barrier, int *local_sense);
+
+// releases whatever barrier_init() set up
+void barrier_destroy(struct gol_barrier *barrier);
+
+// adds up the per-thread live counts into total_live (thread 0 only)
+void reduce_live_counts(struct gol_data *data, long long round);
+
+// adds a piece of the given size to the bytes an arena needs
+void arena_plan(size_t *low, size_t *high, size_t bytes);
+
+// maps an arena with room for the planned pieces
+struct gol_arena *arena_create(size_t low, size_t high, int hugetlb);
+
+// takes a zeroed piece of an arena
+void *arena_alloc(struct gol_arena *arena, size_t bytes);
+
+// unmaps an arena and everything in it
+void arena_destroy(struct gol_arena *arena);
+
+int** row_partition(int rows, int cols, int num_threads, struct gol_arena *arena);
+int** col_partition(int rows, int cols, int num_threads, struct gol_arena *arena);
+int** tile_partition(int rows, int cols, int num_threads, struct gol_arena *arena);
+
+// picks tile_rows and tile_cols so that a tile of both boards fits in L2
+void size_tiles(struct gol_data *data);
+
+// pins the calling thread to one of the cores the process may run on
+void pin_thread(int id);
+
+// zeroes the calling thread's block of both boards, so its pages are local
+void first_touch(struct gol_data *data, int row0, int row1, int col0, int col1);
+
+// places the live cells saved by init_game_data_from_args() on the board
+void place_initial_cells(struct gol_data *data);
+
+// the 64 cells of word w of row r of the --random board
+uint64_t random_word(struct gol_data *data, int r, int w);
+
+// first-touches a block of the board and fills it from --random
+long long random_fill(struct gol_data *data, int row0, int row1, int col0, int col1);
+
+// advances one rectangle of the board, returns its live count
+long long step_tile(struct gol_data *data, int row0, int row1, int col0, int col1);
+
+// builds the HashLife universe from the cells read from the input file
+void hashlife_init(struct gol_data *data);
+
+// runs all the rounds with the HashLife engine
+void play_hashlife(struct gol_data *data);
+
+// releases the HashLife universe
+void hashlife_free(struct gol_data *data);
+
+// builds the sparse world from the cells read from the input file
+void sparse_init(struct gol_data *data);
+
+// computes the next generation of the sparse world, returns its population
+long long sparse_step(struct gol_data *data);
+
+// runs all the rounds with the sparse engine
+void play_sparse(struct gol_data *data);
+
+// releases the sparse world
+void sparse_free(struct gol_data *data);
+
+// like step_tile(), but skips the parts of it that can't change (--active)
+long long step_active(struct gol_data *data, int row0, int row1, int col0, int col1);
+
+// hands every thread its share of the tiles for the next generation
+void fill_deques(struct gol_data *data);
+
+// computes this thread's tiles, then steals from the others until none are left
+long long run_stealing(struct gol_data *data, int id);
 
 /************ Definitions for using ParVisi library ***********/
 /* initialization for the ParaVisi library (DO NOT MODIFY) */
@@ -123,8 +934,17 @@ int main(int argc, char **argv) {
     
     int ret;
     struct gol_data data;
-    double secs;
+    struct gol_timing *timing;
+    double start;
     struct gol_data *tid_args;
+    struct gol_barrier barrier;
+
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return run_bench(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return run_batch(argc, argv);
+    }
 
     /* check number of command line arguments */
     if (argc < 6) {
@@ -135,7 +955,15 @@ int main(int argc, char **argv) {
 
     /* Initialize game state (all fields in data) from information
      * read from input file */
+    timing = calloc(1, sizeof(struct gol_timing));
+    if(timing == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    start = timing_now();
     ret = init_game_data_from_args(&data, argc, argv);
+    timing->load = timing_now() - start;
+    data.timing = timing;
     if (ret != 0) {
         printf("Initialization error: file %s, mode %s\n", argv[1], argv[2]);
         exit(1);
@@ -144,31 +972,57 @@ int main(int argc, char **argv) {
     pthread_t *tid;
     int r;
     int threads = data.num_threads;
-    tid = malloc(sizeof(pthread_t)  *threads);
-    tid_args = malloc(sizeof(struct gol_data) * threads);
+    //the arena was sized for these in init_game_data_from_args(), and
+    //comes zeroed
+    tid = arena_alloc(data.arena, sizeof(pthread_t) * threads);
+    tid_args = arena_alloc(data.arena, sizeof(struct gol_data) * threads);
+    barrier_init(&barrier, data.barrier_kind, threads);
+    data.barrier = &barrier;
+    data.barrier_sense = 0;
+    data.live_counts = arena_alloc(data.arena, sizeof(struct gol_counter) * threads);
+    data.deques = arena_alloc(data.arena, sizeof(struct gol_deque) * threads);
+    data.thread_stats = NULL;
+    if(data.print_info == 1){
+        data.thread_stats = arena_alloc(data.arena, sizeof(struct gol_thread_stats) * threads);
+    }
     
     
 
     // starts counting the program runtime 
-    ret = gettimeofday(&start_time, NULL);
-    if(ret!= 0){
-        printf("Timing Error!");
-    }
+    start = timing_now();
 
     /* initialize ParaVisi animation (if applicable) */
     if (data.output_mode == OUTPUT_VISI) {
         setup_animation(&data);
     }
-
-    /* ASCII output: clear screen & print the initial board */
+    data.screen = NULL;
     if (data.output_mode == OUTPUT_ASCII) {
-        if (system("clear")) { perror("clear"); exit(1); }
-        total_live = data.num_alive_cells;
-        print_board(&data, 0);
+        screen_init(&data);
+    }
+    render_start(&data);
+    //ParaVis without the render thread: every worker repaints the pixels
+    //of the cells it changed as it goes, so thread 0 only signals a frame
+    data.visi_dirty = data.output_mode == OUTPUT_VISI && data.render == NULL
+        && (data.engine == ENGINE_DENSE || data.engine == ENGINE_BITPACK);
+
+    total_live = data.num_alive_cells;
+    //a --random board is only counted once the threads have filled it
+    if(data.population_file != NULL && !data.random_fill){
+        fprintf(data.population_file, "%lld %lld\n", data.generation0, total_live);
     }
+    checkpoint_start(&data);
 
     /* Invoke play_gol in different ways based on the run mode */
-    if (data.output_mode == OUTPUT_NONE) {  // run with no animation
+    if (data.engine == ENGINE_HASHLIFE) {  // one thread, all rounds at once
+        play_hashlife(&data);
+    }
+    else if (data.engine == ENGINE_SPARSE) {
+        play_sparse(&data);
+    }
+    else if (data.procs > 0) {  // row blocks in separate processes
+        play_procs(&data);
+    }
+    else if (data.output_mode == OUTPUT_NONE) {  // run with no animation
         //play_gol(&data);
         for(int i = 0; i<data.num_threads;i++){ 
             tid_args[i] = data; /* make a private copy for each thread */ //insert struct jsadklfjklsdjklfqjklsdjaklsdj
@@ -194,38 +1048,72 @@ int main(int argc, char **argv) {
         // OUTPUT_VISI: run with ParaVisi animation
         // tell ParaVisi that it should run play_gol
         //connect_animation(play_gol, &data);
+        for(int i = 0; i<data.num_threads;i++){
+            tid_args[i] = data; /* make a private copy for each thread */
+            tid_args[i].id = i;       /* set logical ID for this thread */
+            if(pthread_create(&tid[i], NULL, play_gol_thread, &tid_args[i]) != 0){
+                printf("Error: unable to create thread %d\n", i);
+                exit(1);
+            }
+        }
         // start ParaVisi animation
-        //run_animation(data.handle, data.iters);
+        run_animation(data.handle, data.iters);
+        for(int i = 0; i<data.num_threads;i++){
+            pthread_join(tid[i], NULL);
+        }
     }
 
+    checkpoint_stop(&data);
+    render_stop(&data);
+
     // stops counting the program runtime
-    ret = gettimeofday(&stop_time, NULL);
-    if(ret!= 0){
-        printf("Timing Error!");
+    timing->run = timing_now() - start;
+
+    //a board that stabilized stopped early: the report counts the rounds
+    //that were run, and the live cells are the ones the full run would end with
+    if(data.cycles != NULL && data.cycles->stop){
+        data.rounds = data.cycles->generation - data.generation0;
+        total_live = cycles_population(data.cycles, data.iters);
     }
-        
   
     if (data.output_mode != OUTPUT_VISI) {
-        secs = 0.0;
-        int start; 
-        int end;
-
-        /*  uses the conversion factor to unify the time units
-         *  and sums them together. */
-        start = start_time.tv_sec *100000 + start_time.tv_usec;
-        end = stop_time.tv_sec *100000 + stop_time.tv_usec;
-
-        // computes the runtime         
-        secs = (abs(end - start))/100000;
-
-        /* Print the total runtime, in seconds. */
-        fprintf(stdout, "Total time: %0.3f seconds\n", secs);
-        fprintf(stdout, "Number of live cells after %d rounds: %d\n\n",
+        if(data.cycles != NULL && data.cycles->stop){
+            printf("stabilized at generation %lld with period %d\n",
+                    data.cycles->stable_gen, data.cycles->period);
+        }
+        /* Print the total runtime, in seconds, and where it went. */
+        print_report(&data);
+        if(data.thread_stats != NULL && data.engine != ENGINE_HASHLIFE
+                && data.engine != ENGINE_SPARSE && data.procs == 0){
+            print_thread_stats(&data);
+        }
+        if(data.temporal != NULL && data.print_info == 1){
+            printf("temporal blocking: %d generations per pass%s\n", data.temporal->k,
+                    data.temporal->tuning ? " (still tuning)" : "");
+        }
+        fprintf(stdout, "Number of live cells after %d rounds: %lld\n\n",
                 data.iters, total_live);
     }
+    free(timing);
 
-    free(data.current);
-    free(data.next);
+    if(data.input_map != NULL){
+        munmap(data.input_map, data.input_map_len);
+    }
+    hashlife_free(&data);
+    screen_free(&data);
+    sparse_free(&data);
+    barrier_destroy(&barrier);
+    if(data.population_file != NULL){
+        fclose(data.population_file);
+    }
+    if(data.cycles != NULL){
+        free(data.cycles->hashes);
+        free(data.cycles->pops);
+        free(data.cycles);
+    }
+    free(data.temporal);
+    //the boards, the partitions, the per-thread state and tid/tid_args
+    arena_destroy(data.arena);
 
     return 0;
 }
@@ -242,20 +1130,214 @@ int main(int argc, char **argv) {
  *         contains the inputs of the user
  */
 int init_game_data_from_args(struct gol_data *data, int argc, char **argv) {
-    FILE *file;
-    int rows, cols, num_alive_cells, x, y, num_threads;
+    struct gol_input input;
+    int rows, cols, num_threads;
+    long long num_alive_cells;
+    int iters_flag = -1, size_rows = 0, size_cols = 0;
+    const char *input_path = argv[1];
+    long long checkpoint_every = 0;
+    double checkpoint_secs = 0;
+    const char *checkpoint_path = NULL;
+    int detect_cycles = 0, max_period = CYCLE_DEFAULT_PERIOD;
+    int temporal = 0;
+    int hugetlb = 0;
+    int random_rows = 0, random_cols = 0;
+    double density = 0.5;
+    int world_flag = 0;
 
     //Check that the correct number of command line arguments are provided
-    if(argc != 6){
-     printf("Usage: %s <input_file> <output_mode> <num_threads> <parallelization_mode> <print_info>\n", argv[0]);
+    if(argc < 6){
+     printf("Usage: %s <input_file> <output_mode> <num_threads> <parallelization_mode> <print_info> [--iters N] [--size RxC] [--resume FILE] [--checkpoint FILE [--checkpoint-every N] [--checkpoint-secs T]] [--report-json FILE] [--report-csv FILE] [--perf] [--engine dense|bitpack|hashlife|sparse] [--hashlife-nodes N] [--simd auto|scalar|sse2|avx2|avx512] [--world torus|bounded] [--barrier pthread|spin] [--rule RULE] [--population FILE] [--active] [--ascii-diff] [--async-render [--fps N]] [--detect-cycles [--max-period N]] [--temporal K|auto] [--procs N] [--hugetlb] [--random RxC [--density P] [--seed N]]\n", argv[0]);
      return 1;
     }
 
-    // opens the file
-    file = fopen(argv[1], "r");
-    if (file == NULL){
-        printf("Error unable to open file %s\n", argv[1]);
-        exit(1);
+    //optional flags that follow the required arguments
+    data->engine = ENGINE_DENSE;
+    data->simd = SIMD_AUTO;
+    data->world = WORLD_TORUS;
+    data->barrier_kind = BARRIER_PTHREAD;
+    data->population_file = NULL;
+    data->report_json = NULL;
+    data->report_csv = NULL;
+    data->perf = 0;
+    data->ascii_diff = 0;
+    data->async_render = 0;
+    data->fps = 1000000 / SLEEP_USECS;
+    data->active = 0;
+    data->procs = 0;
+    data->random_fill = 0;
+    data->random_seed = 1;
+    data->hl_max_nodes = HL_DEFAULT_NODES;
+    data->rule_birth = RULE_MASK(3);
+    data->rule_survive = RULE_MASK(2) | RULE_MASK(3);
+    data->hl = NULL;
+    data->sparse = NULL;
+    for(int i = 6; i < argc; i++){
+        if(strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "dense") == 0){
+                data->engine = ENGINE_DENSE;
+            }else if(strcmp(argv[i], "bitpack") == 0){
+                data->engine = ENGINE_BITPACK;
+            }else if(strcmp(argv[i], "hashlife") == 0){
+                data->engine = ENGINE_HASHLIFE;
+            }else if(strcmp(argv[i], "sparse") == 0){
+                data->engine = ENGINE_SPARSE;
+            }else{
+                printf("Error: unknown engine %s (use dense, bitpack, hashlife or sparse)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--hashlife-nodes") == 0 && i + 1 < argc){
+            i++;
+            data->hl_max_nodes = atoll(argv[i]);
+            if(data->hl_max_nodes < 1){
+                printf("Error: --hashlife-nodes must be at least 1\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--simd") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "auto") == 0){
+                data->simd = SIMD_AUTO;
+            }else if(strcmp(argv[i], "scalar") == 0){
+                data->simd = SIMD_SCALAR;
+            }else if(strcmp(argv[i], "sse2") == 0){
+                data->simd = SIMD_SSE2;
+            }else if(strcmp(argv[i], "avx2") == 0){
+                data->simd = SIMD_AVX2;
+            }else if(strcmp(argv[i], "avx512") == 0){
+                data->simd = SIMD_AVX512;
+            }else{
+                printf("Error: unknown simd kernel %s\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--world") == 0 && i + 1 < argc){
+            i++;
+            world_flag = 1;
+            if(strcmp(argv[i], "torus") == 0){
+                data->world = WORLD_TORUS;
+            }else if(strcmp(argv[i], "bounded") == 0){
+                data->world = WORLD_BOUNDED;
+            }else{
+                printf("Error: unknown world %s (use torus or bounded)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--barrier") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "pthread") == 0){
+                data->barrier_kind = BARRIER_PTHREAD;
+            }else if(strcmp(argv[i], "spin") == 0){
+                data->barrier_kind = BARRIER_SPIN;
+            }else{
+                printf("Error: unknown barrier %s (use pthread or spin)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--population") == 0 && i + 1 < argc){
+            i++;
+            data->population_file = fopen(argv[i], "w");
+            if(data->population_file == NULL){
+                printf("Error unable to open file %s\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--async-render") == 0){
+            data->async_render = 1;
+        }else if(strcmp(argv[i], "--fps") == 0 && i + 1 < argc){
+            i++;
+            data->fps = atoi(argv[i]);
+            if(data->fps < 1 || data->fps > 1000){
+                printf("Error: --fps must be 1 to 1000\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--ascii-diff") == 0){
+            data->ascii_diff = 1;
+        }else if(strcmp(argv[i], "--rule") == 0 && i + 1 < argc){
+            i++;
+            if(parse_rule(argv[i], &data->rule_birth, &data->rule_survive) != 0){
+                printf("Error: bad rule %s (use B/S notation, like B36/S23)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--detect-cycles") == 0){
+            detect_cycles = 1;
+        }else if(strcmp(argv[i], "--max-period") == 0 && i + 1 < argc){
+            i++;
+            max_period = atoi(argv[i]);
+            if(max_period < 1){
+                printf("Error: --max-period must be at least 1\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--temporal") == 0 && i + 1 < argc){
+            i++;
+            temporal = strcmp(argv[i], "auto") == 0 ? TEMPORAL_AUTO : atoi(argv[i]);
+            if(temporal == 0 || temporal < TEMPORAL_AUTO){
+                printf("Error: --temporal must be auto or at least 1\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--procs") == 0 && i + 1 < argc){
+            i++;
+            data->procs = atoi(argv[i]);
+            if(data->procs < 1 || data->procs > PROCS_MAX){
+                printf("Error: --procs must be 1 to %d\n", PROCS_MAX);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--hugetlb") == 0){
+            hugetlb = 1;
+        }else if(strcmp(argv[i], "--random") == 0 && i + 1 < argc){
+            i++;
+            if(sscanf(argv[i], "%dx%d", &random_rows, &random_cols) != 2
+                    || random_rows <= 0 || random_cols <= 0){
+                printf("Error: --random must look like 100x200\n");
+                exit(1);
+            }
+            data->random_fill = 1;
+        }else if(strcmp(argv[i], "--density") == 0 && i + 1 < argc){
+            i++;
+            density = atof(argv[i]);
+            if(density < 0 || density > 1){
+                printf("Error: --density must be between 0 and 1\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc){
+            i++;
+            data->random_seed = strtoull(argv[i], NULL, 10);
+        }else if(strcmp(argv[i], "--perf") == 0){
+            data->perf = 1;
+        }else if(strcmp(argv[i], "--active") == 0){
+            data->active = 1;
+        }else if(strcmp(argv[i], "--iters") == 0 && i + 1 < argc){
+            i++;
+            iters_flag = atoi(argv[i]);
+            if(iters_flag < 0){
+                printf("Error: --iters must not be negative\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--report-json") == 0 && i + 1 < argc){
+            i++;
+            data->report_json = argv[i];
+        }else if(strcmp(argv[i], "--report-csv") == 0 && i + 1 < argc){
+            i++;
+            data->report_csv = argv[i];
+        }else if(strcmp(argv[i], "--resume") == 0 && i + 1 < argc){
+            i++;
+            input_path = argv[i];
+        }else if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc){
+            i++;
+            checkpoint_path = argv[i];
+        }else if(strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc){
+            i++;
+            checkpoint_every = atoll(argv[i]);
+        }else if(strcmp(argv[i], "--checkpoint-secs") == 0 && i + 1 < argc){
+            i++;
+            checkpoint_secs = atof(argv[i]);
+        }else if(strcmp(argv[i], "--size") == 0 && i + 1 < argc){
+            i++;
+            if(sscanf(argv[i], "%dx%d", &size_rows, &size_cols) != 2
+                    || size_rows <= 0 || size_cols <= 0){
+                printf("Error: --size must look like 100x200\n");
+                exit(1);
+            }
+        }else{
+            printf("Error: unknown option %s\n", argv[i]);
+            exit(1);
+        }
     }
 
     // Sets output_mode from the command line arguments to a variable
@@ -265,8 +1347,52 @@ int init_game_data_from_args(struct gol_data *data, int argc, char **argv) {
         exit(1);
     }
     //Reads in the number of rows, colums, number of alive cells from file
-    int ret = fscanf(file, "%d %d %d %d", &data->rows, &data->cols, &data->iters, &data->num_alive_cells);
-    if(ret != 4){
+    data->generation0 = 0;
+    if(data->random_fill){
+        //no file at all: the size is --random's, the cells come later
+        if(strcmp(input_path, "-") != 0){
+            printf("Error: --random takes - as the input file\n");
+            exit(1);
+        }
+        if(data->engine != ENGINE_DENSE && data->engine != ENGINE_BITPACK){
+            printf("Error: --random needs the dense or bitpack engine\n");
+            exit(1);
+        }
+        input.format = INPUT_RANDOM;
+        input.buf = NULL;
+        input.len = 0;
+        data->rows = random_rows;
+        data->cols = random_cols;
+        data->iters = -1;
+        data->num_alive_cells = 0;
+        data->random_density = (uint32_t)llround(density * (1 << RANDOM_BITS));
+    }else{
+        open_input(data, input_path, &input);
+    }
+    if(input_path != argv[1] && input.format != INPUT_BINARY){
+        printf("Error: %s is not a checkpoint\n", input_path);
+        exit(1);
+    }
+    if(size_rows > 0){
+        if(input.format != INPUT_RLE || size_rows < data->rows || size_cols < data->cols){
+            printf("Error: --size needs an RLE pattern that fits in the board\n");
+            exit(1);
+        }
+        data->rows = size_rows;
+        data->cols = size_cols;
+    }
+    if(iters_flag >= 0){
+        data->iters = iters_flag;
+    }
+    if(data->iters < 0 && data->random_fill){
+        printf("Error: --random needs --iters N\n");
+        exit(1);
+    }
+    if(data->iters < 0){
+        printf("Error: %s has no round count, pass --iters N\n", input_path);
+        exit(1);
+    }
+    if(data->rows <= 0 || data->cols <= 0 || data->num_alive_cells < 0){
         printf("Error: improper file format.\n");
         exit(1);
     }
@@ -276,55 +1402,281 @@ int init_game_data_from_args(struct gol_data *data, int argc, char **argv) {
     data->num_threads = atoi(argv[3]);
     printf("%d\n", data->num_threads);              //for debugging purposes >.......hjsdfkhsjkhjdkfzhfjkeshbsd
 
+    if(data->num_threads < 1){
+        printf("Error: num_threads must be at least 1\n");
+        exit(1);
+    }
+
     //gets the parallelization mode //0 =rows, 1 == column
     data->para_mode = atoi(argv[4]);
 
     //gets the decision on whether or not the thread allocation is printed
     data->print_info = atoi(argv[5]);
+
+    //the rule as a table, for the dense kernel, HashLife and sparse
+    for(int k = 0; k <= 8; k++){
+        data->rule_next[0][k] = (data->rule_birth >> k) & 1;
+        data->rule_next[1][k] = (data->rule_survive >> k) & 1;
+    }
+    //with B0 every dead cell far from the pattern is born, which an
+    //unbounded plane or a list of live cells can't hold
+    if((data->rule_birth & RULE_MASK(0))
+            && (data->engine == ENGINE_HASHLIFE || data->engine == ENGINE_SPARSE)){
+        printf("Error: rules with B0 need the dense or bitpack engine\n");
+        exit(1);
+    }
+    //HashLife's universe grows with the pattern, so it has no edges to
+    //wrap around or to stop at
+    if(world_flag && data->engine == ENGINE_HASHLIFE){
+        printf("Error: --engine hashlife runs on an unbounded plane, --world does not apply\n");
+        exit(1);
+    }
     
 
     // sets the data from the struct to variables
     num_alive_cells = data->num_alive_cells;
     rows = data->rows;
     cols = data->cols;
+    //a checkpoint has already run some of the rounds
+    data->rounds = data->iters - data->generation0 > 0 ? data->iters - data->generation0 : 0;
 
+    data->checkpoint = NULL;
+    if(checkpoint_path != NULL){
+        if(data->engine != ENGINE_DENSE && data->engine != ENGINE_BITPACK){
+            printf("Error: --checkpoint needs the dense or bitpack engine\n");
+            exit(1);
+        }
+        if(checkpoint_every <= 0 && checkpoint_secs <= 0){
+            printf("Error: --checkpoint needs --checkpoint-every or --checkpoint-secs\n");
+            exit(1);
+        }
+        data->checkpoint = calloc(1, sizeof(struct gol_checkpointer));
+        if(data->checkpoint == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+        data->checkpoint->path = checkpoint_path;
+        data->checkpoint->every = checkpoint_every;
+        data->checkpoint->secs = checkpoint_secs;
+    }
+    data->cycles = NULL;
+    if(detect_cycles){
+        if(data->engine != ENGINE_DENSE && data->engine != ENGINE_BITPACK){
+            printf("Error: --detect-cycles needs the dense or bitpack engine\n");
+            exit(1);
+        }
+        data->cycles = calloc(1, sizeof(struct gol_cycles));
+        if(data->cycles == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+        data->cycles->max_period = max_period;
+        data->cycles->hashes = malloc(sizeof(uint64_t) * (max_period + 1));
+        data->cycles->pops = malloc(sizeof(long long) * (max_period + 1));
+        if(data->cycles->hashes == NULL || data->cycles->pops == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    data->current = NULL;
+    data->next = NULL;
+    data->bcurrent = NULL;
+    data->bnext = NULL;
+    data->bzero = NULL;
+    data->stride = cols + 2;
+    data->initial_cells = NULL;
+    data->mapped_board = NULL;
+    data->input_map = NULL;
 
+    //the bit-packed board splits columns on word boundaries, so its
+    //column partition is over words instead of cells
+    data->words_per_row = (cols + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    if(cols % BITS_PER_WORD == 0){
+        data->last_mask = ~(uint64_t)0;
+    }else{
+        data->last_mask = ((uint64_t)1 << (cols % BITS_PER_WORD)) - 1;
+    }
 
-    //Make a board set equal to dead and then go through and place the cells that are alive
-    data->current = malloc(sizeof(int) * rows * cols);
-    if (data->current == NULL){
-        printf("ERROR: malloc failed!\n");
-        exit(1);
+    //everything below that lives until exit comes out of one arena, so
+    //add up what it needs first: the boards, the partition table, the
+    //--active maps and the per-thread state main() sets up
+    size_t low = 0, high = 0;
+    size_t n = data->num_threads;
+    size_t board_words = (size_t)rows * data->words_per_row;
+    if(data->engine == ENGINE_BITPACK){
+        if(input.format != INPUT_BINARY || data->para_mode == PARA_TILES){
+            arena_plan(&low, &high, board_words * sizeof(uint64_t));
+        }
+        arena_plan(&low, &high, board_words * sizeof(uint64_t));
+        arena_plan(&low, &high, data->words_per_row * sizeof(uint64_t));
+    }else if(data->engine == ENGINE_DENSE){
+        arena_plan(&low, &high, sizeof(int) * (size_t)(rows + 2) * (cols + 2));
+        arena_plan(&low, &high, sizeof(int) * (size_t)(rows + 2) * (cols + 2));
+    }
+    arena_plan(&low, &high, n * (sizeof(int*) + 4 * sizeof(int)));
+    if(data->active){
+        size_t across = data->engine == ENGINE_BITPACK ? data->words_per_row
+            : (cols + ACTIVE_TILE_COLS - 1) / ACTIVE_TILE_COLS;
+        size_t tiles = (size_t)((rows + ACTIVE_TILE_ROWS - 1) / ACTIVE_TILE_ROWS) * across;
+        arena_plan(&low, &high, tiles);
+        arena_plan(&low, &high, tiles);
+    }
+    arena_plan(&low, &high, n * sizeof(pthread_t));
+    arena_plan(&low, &high, n * sizeof(struct gol_data));
+    arena_plan(&low, &high, n * sizeof(struct gol_counter));
+    arena_plan(&low, &high, n * sizeof(struct gol_deque));
+    if(data->print_info == 1){
+        arena_plan(&low, &high, n * sizeof(struct gol_thread_stats));
     }
-     make_board(data->current, rows, cols);
+    data->arena = arena_create(low, high, hugetlb);
+    if(data->print_info == 1){
+        printf("arena: %zu bytes, boards in %s\n", data->arena->size,
+                data->arena->hugetlb ? "reserved huge pages"
+                : low > 0 ? "transparent huge pages" : "small pages");
+    }
+
     if(data->para_mode == 0){
-        data->row_partition_info = row_partition(data->rows, data->cols, data->num_threads); 
+        data->row_partition_info = row_partition(data->rows, data->cols, data->num_threads,
+                data->arena);
     }else if(data->para_mode == 1){
-        data->col_partition_info = col_partition(data->rows, data->cols, data->num_threads);
+        if(data->engine == ENGINE_BITPACK){
+            data->col_partition_info = col_partition(data->rows, data->words_per_row,
+                    data->num_threads, data->arena);
+        }else{
+            data->col_partition_info = col_partition(data->rows, data->cols, data->num_threads,
+                    data->arena);
+        }
+    }else if(data->para_mode == PARA_TILES){
+        if(data->engine == ENGINE_BITPACK){
+            data->tile_partition_info = tile_partition(data->rows, data->words_per_row,
+                    data->num_threads, data->arena);
+        }else{
+            data->tile_partition_info = tile_partition(data->rows, data->cols, data->num_threads,
+                    data->arena);
+        }
+    }else if(data->para_mode == PARA_STEAL){
+        //the tiles are cut by size_tiles() below
     }else{
         printf("ERROR: INVALID PARALLELIZATION MODE\n");
         exit(1);
     }
-   //make the next board 
-    data->next = malloc(sizeof(int)*rows*cols);
-    if (data->next == NULL){
-        printf("ERROR: malloc failed!\n");
-        exit(1);
-    }
-    make_board(data->next, rows, cols);
 
-    for (int i = 0; i < num_alive_cells; i++){
-        ret = fscanf(file, "%d %d\n", &x, &y);
-        if(ret != 2){
-            printf("Error Improper file format.\n");
+    size_tiles(data);
+
+    data->temporal = NULL;
+    if(temporal != 0){
+        //blocks skip the generations in between, so nothing that looks at
+        //every generation can run with them
+        if(data->engine != ENGINE_BITPACK || data->para_mode != PARA_ROWS
+                || data->output_mode != OUTPUT_NONE || data->active
+                || data->population_file != NULL || data->cycles != NULL){
+            printf("Error: --temporal needs the bitpack engine, para_mode 0 and no output, "
+                    "--population, --active or --detect-cycles\n");
             exit(1);
-            
         }
-        data->current[x*cols + y] = 1;
+        temporal_init(data, temporal);
+    }
+    if(data->procs > 0){
+        //each process only has its own block, so nothing that needs the
+        //whole board between generations can run with it
+        if(data->engine != ENGINE_BITPACK || data->num_threads != 1
+                || data->output_mode != OUTPUT_NONE || data->active
+                || data->population_file != NULL || data->cycles != NULL
+                || data->checkpoint != NULL || data->temporal != NULL){
+            printf("Error: --procs needs the bitpack engine, num_threads 1 and no output, "
+                    "--population, --active, --detect-cycles, --checkpoint or --temporal\n");
+            exit(1);
+        }
+        if(data->procs > rows){
+            printf("Error: --procs must be at most the number of rows\n");
+            exit(1);
+        }
+    }
+
+    //every tile counts as changed before the first generation, so that
+    //the first one is computed in full
+    data->changed = NULL;
+    data->changed_next = NULL;
+    if(data->active){
+        int unit = data->engine == ENGINE_BITPACK ? 1 : ACTIVE_TILE_COLS;
+        int units = data->engine == ENGINE_BITPACK ? data->words_per_row : cols;
+        data->active_down = (rows + ACTIVE_TILE_ROWS - 1) / ACTIVE_TILE_ROWS;
+        data->active_across = (units + unit - 1) / unit;
+        data->changed = arena_alloc(data->arena, (size_t)data->active_down * data->active_across);
+        data->changed_next = arena_alloc(data->arena,
+                (size_t)data->active_down * data->active_across);
+        memset(data->changed, 1, (size_t)data->active_down * data->active_across);
+    }
+
+    //in para_mode 2 the boards are left untouched here: each thread zeroes
+    //its own block first, so the pages land on its NUMA node, and the live
+    //cells are placed after that. HashLife and the sparse engine build
+    //their worlds from the list.
+    if((data->para_mode == PARA_TILES && !data->random_fill) || data->engine == ENGINE_HASHLIFE
+            || data->engine == ENGINE_SPARSE){
+        data->initial_cells = malloc(sizeof(int) * 2 * (size_t)(num_alive_cells > 0 ? num_alive_cells : 1));
+        if (data->initial_cells == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+
+    if(data->engine == ENGINE_BITPACK){
+        select_bitpack_kernel(data);
+        //both bit-packed boards start out all dead, unless the input is a
+        //binary board, which is mapped as current as it is
+        if(input.format == INPUT_BINARY && data->para_mode != PARA_TILES){
+            data->mapped_board = (uint64_t*)(input.buf + sizeof(struct gol_bin_header));
+            data->bcurrent = data->mapped_board;
+            data->bnext = arena_alloc(data->arena, board_words * sizeof(uint64_t));
+            for(int i = 0; i < rows; i++){
+                if(data->bcurrent[(size_t)(i + 1) * data->words_per_row - 1] & ~data->last_mask){
+                    printf("Error: improper binary file format.\n");
+                    exit(1);
+                }
+            }
+        }else{
+            //the arena's pages are untouched until someone writes them, so
+            //in para_mode 2 the threads still get to first-touch them
+            data->bcurrent = arena_alloc(data->arena, board_words * sizeof(uint64_t));
+            data->bnext = arena_alloc(data->arena, board_words * sizeof(uint64_t));
+        }
+        data->bzero = arena_alloc(data->arena, data->words_per_row * sizeof(uint64_t));
+    }else if(data->engine == ENGINE_DENSE){
+        //Make a board set equal to dead and then go through and place the cells that are alive
+        //both boards get a one-cell halo on every side so that the kernel
+        //never has to wrap a neighbor coordinate
+        data->current = arena_alloc(data->arena, sizeof(int) * (size_t)(rows + 2) * (cols + 2));
+        //make the next board 
+        data->next = arena_alloc(data->arena, sizeof(int) * (size_t)(rows + 2) * (cols + 2));
+        if(data->para_mode != PARA_TILES && !data->random_fill){
+            make_board(data->current, rows + 2, cols + 2);
+            make_board(data->next, rows + 2, cols + 2);
+        }
+    }
+
+    //a --random board is filled by the threads, see random_fill()
+    if(!data->random_fill){
+        read_cells(data, &input);
+    }
+    if(data->engine == ENGINE_DENSE && data->initial_cells == NULL && !data->random_fill){
+        refresh_halo(data, data->current);
+    }
+    if(data->engine == ENGINE_HASHLIFE || data->engine == ENGINE_SPARSE){
+        if(data->engine == ENGINE_HASHLIFE){
+            hashlife_init(data);
+            if(data->print_info == 1){
+                printf("world: unbounded\n");
+            }
+        }else{
+            sparse_init(data);
+        }
+        free(data->initial_cells);
+        data->initial_cells = NULL;
     }
 
     //close the file when done with it
-    ret = fclose(file);
+    close_input(data, &input);
     // if(ret != 0){ 
     //      for(int j = 0; j < cols; j++){
     //          arr[i*cols + j] = 0;
@@ -333,8 +1685,170 @@ int init_game_data_from_args(struct gol_data *data, int argc, char **argv) {
     return 0;
 }
 
-int** row_partition(int rows, int cols, int num_threads){ //double free in main!!
-    int ** partition_info = (int**)malloc(num_threads * sizeof(int*));
+/* This function parses a Life-like rulestring into its birth and survival
+ * masks (bit k set: born / survives with k live neighbors). It takes the
+ * B/S notation, "B36/S23" (any case, the slash optional), and the older
+ * S/B notation, "23/36".
+ * str: the rulestring
+ * birth, survive: the masks, set if the rule is valid
+ * returns: 0 if the rule is valid, -1 if not */
+int parse_rule(const char *str, unsigned *birth, unsigned *survive){
+    unsigned masks[2] = {0, 0};   // birth, survive
+    int part = -1;
+    int bs = str[0] == 'B' || str[0] == 'b';
+
+    if(!bs && strchr(str, '/') == NULL){
+        return -1;
+    }
+    if(!bs){
+        part = 1;   // S/B: survival digits come first
+    }
+    for(const char *p = str; *p != '\0'; p++){
+        if(*p == 'B' || *p == 'b'){
+            part = 0;
+        }else if(*p == 'S' || *p == 's'){
+            part = 1;
+        }else if(*p == '/'){
+            if(!bs){
+                part = 0;
+            }
+        }else if(*p >= '0' && *p <= '8' && part >= 0){
+            masks[part] |= RULE_MASK(*p - '0');
+        }else{
+            return -1;
+        }
+    }
+    *birth = masks[0];
+    *survive = masks[1];
+    return 0;
+}
+
+/********************** Arena **********************/
+
+/* Rounds bytes up to a multiple of align, a power of two */
+static inline size_t round_up(size_t bytes, size_t align){
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+/* This function adds a piece to the room an arena is going to need, on
+ * the side arena_alloc() will take it from.
+ * low: bytes needed at the bottom, for boards of a huge page or more
+ * high: bytes needed at the top, for everything else
+ * bytes: the size of the piece
+ * returns: none */
+void arena_plan(size_t *low, size_t *high, size_t bytes){
+    if(bytes >= HUGE_PAGE){
+        *low += round_up(bytes + (ARENA_SKEWS - 1) * ARENA_SKEW, HUGE_PAGE);
+    }else{
+        *high += round_up(bytes, CACHE_LINE);
+    }
+}
+
+/* This function maps an arena big enough for the pieces arena_plan()
+ * added up, starting on a huge page. With hugetlb it first tries reserved
+ * huge pages; otherwise, or if there aren't enough, it maps normal pages
+ * and asks for transparent huge pages under the boards, so that walking
+ * a big board needs 512 times fewer TLB entries. The pages are zero and
+ * untouched until the first write.
+ * low, high: the bytes arena_plan() added up
+ * hugetlb: 1 to try MAP_HUGETLB first
+ * returns: the arena */
+struct gol_arena *arena_create(size_t low, size_t high, int hugetlb){
+    size_t head = round_up(sizeof(struct gol_arena), CACHE_LINE);
+    size_t size = round_up(low + high + head, HUGE_PAGE);
+    char *base = MAP_FAILED;
+    int reserved = 0;
+
+    if(hugetlb){
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        reserved = base != MAP_FAILED;
+    }
+    if(base == MAP_FAILED){
+        //map a huge page extra and trim it off the ends, so the arena
+        //starts on a huge page boundary
+        char *raw = mmap(NULL, size + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+        base = (char*)round_up((size_t)raw, HUGE_PAGE);
+        if(base > raw){
+            munmap(raw, base - raw);
+        }
+        munmap(base + size, raw + HUGE_PAGE - base);
+        if(low > 0){
+            madvise(base, low, MADV_HUGEPAGE);
+        }
+    }
+
+    struct gol_arena *arena = (struct gol_arena*)(base + size - head);
+    arena->base = base;
+    arena->size = size;
+    arena->low = 0;
+    arena->high = size - head;
+    arena->boards = 0;
+    arena->hugetlb = reserved;
+    return arena;
+}
+
+/* This function takes a piece of an arena: a board of a huge page or more
+ * from the bottom, in huge pages of its own, anything else from the top,
+ * starting on a cache line. The piece is zero.
+ * arena: the arena, with room planned for the piece
+ * bytes: the size of the piece
+ * returns: the piece */
+void *arena_alloc(struct gol_arena *arena, size_t bytes){
+    char *piece;
+
+    if(bytes >= HUGE_PAGE){
+        size_t skew = (size_t)(arena->boards++ % ARENA_SKEWS) * ARENA_SKEW;
+        piece = arena->base + arena->low + skew;
+        arena->low += round_up(bytes + (ARENA_SKEWS - 1) * ARENA_SKEW, HUGE_PAGE);
+    }else{
+        arena->high -= round_up(bytes, CACHE_LINE);
+        piece = arena->base + arena->high;
+    }
+    if(arena->low > arena->high){
+        printf("ERROR: arena out of room!\n");
+        exit(1);
+    }
+    return piece;
+}
+
+/* This function unmaps an arena, which frees everything taken from it.
+ * arena: the arena, or NULL
+ * returns: none */
+void arena_destroy(struct gol_arena *arena){
+    if(arena != NULL){
+        munmap(arena->base, arena->size);
+    }
+}
+
+/* This function allocates a partition table of num_threads rows of width
+ * ints in one piece: the row pointers, then the rows.
+ * num_threads: rows in the table
+ * width: ints in a row
+ * arena: the arena to take it from, or NULL to malloc it (free it with
+ *        one free())
+ * returns: the table */
+static int** partition_alloc(int num_threads, int width, struct gol_arena *arena){
+    size_t bytes = num_threads * (sizeof(int*) + width * sizeof(int));
+    int **partition_info = arena != NULL ? arena_alloc(arena, bytes) : malloc(bytes);
+    if(partition_info == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    int *cells = (int*)(partition_info + num_threads);
+    for(int i = 0; i < num_threads; i++){
+        partition_info[i] = cells + (size_t)i * width;
+    }
+    return partition_info;
+}
+
+int** row_partition(int rows, int cols, int num_threads, struct gol_arena *arena){
+    int ** partition_info = partition_alloc(num_threads, 2, arena);
     int cells_per_thread = rows / num_threads;
     int extra_cells = rows % num_threads;
     int start_row = 0;
@@ -345,7 +1859,6 @@ int** row_partition(int rows, int cols, int num_threads){ //double free in main!
             end_row++;
             extra_cells--;
         }
-        partition_info[i] = (int*)malloc(2 * sizeof(int));
         partition_info[i][0] = start_row;
         partition_info[i][1] = end_row;
         start_row = end_row + 1;
@@ -353,8 +1866,8 @@ int** row_partition(int rows, int cols, int num_threads){ //double free in main!
     return partition_info;
 }
 
-int** col_partition(int rows, int cols, int num_threads){ //double free in main!!
-    int ** partition_info = (int**)malloc(num_threads * sizeof(int*));
+int** col_partition(int rows, int cols, int num_threads, struct gol_arena *arena){
+    int ** partition_info = partition_alloc(num_threads, 2, arena);
     int cells_per_thread = cols / num_threads;
     int extra_cells = cols % num_threads;
     int start_col = 0;
@@ -365,267 +1878,4369 @@ int** col_partition(int rows, int cols, int num_threads){ //double free in main!
             end_col++;
             extra_cells--;
         }
-        partition_info[i] = (int*)malloc(2 * sizeof(int));
         partition_info[i][0] = start_col;
         partition_info[i][1] = end_col;
         start_col = end_col + 1;
     }
     return partition_info;
 }
-/* helper function to initialize the array that makes up the board
- * arr: is the array of type int
- * rows: the number of rows in the file
- * cols: the number of columns in the file
- * returns: none */
-void make_board(int *arr, int rows, int cols){
-    int i, j;
-    for(i = 0; i < rows; i++){
-        for(j = 0; j < cols; j++){
-            arr[i*cols + j] = 0;
+/* This function splits the board into a grid of 2D blocks, one per
+ * thread. The grid shape is the factorization of num_threads that gives the
+ * blocks the shortest edges, since the edges are what a thread has to read
+ * from its neighbors' blocks.
+ * rows: the number of rows of the board
+ * cols: the number of columns (words, for the bitpack engine)
+ * num_threads: the number of threads
+ * arena: the arena to take the table from, or NULL to malloc it
+ * returns: for each thread, its first and last row and first and last
+ *          column */
+int** tile_partition(int rows, int cols, int num_threads, struct gol_arena *arena){
+    int ** partition_info = partition_alloc(num_threads, 4, arena);
+    int grid_rows = 1;
+    long long best = -1;
+
+    for(int pr = 1; pr <= num_threads; pr++){
+        if(num_threads % pr != 0){
+            continue;
         }
+        int pc = num_threads / pr;
+        long long edge = (long long)rows * (pc - 1) + (long long)cols * (pr - 1);
+        if(best < 0 || edge < best){
+            best = edge;
+            grid_rows = pr;
+        }
+    }
+    int grid_cols = num_threads / grid_rows;
+
+    int **row_info = row_partition(rows, cols, grid_rows, NULL);
+    int **col_info = col_partition(rows, cols, grid_cols, NULL);
+    for(int i = 0; i < num_threads; i++){
+        partition_info[i][0] = row_info[i / grid_cols][0];
+        partition_info[i][1] = row_info[i / grid_cols][1];
+        partition_info[i][2] = col_info[i % grid_cols][0];
+        partition_info[i][3] = col_info[i % grid_cols][1];
     }
+    free(row_info);
+    free(col_info);
+    return partition_info;
 }
-void* play_gol_thread(void* arg){
-    //Unpack the arguments that are passed into the thread
-    struct gol_data *data;
-    data = (struct gol_data*) arg;
-    int id = data->id;
-    int start_row = 0;
-    int end_row = data->rows - 1;
-    int start_col = 0;
-    int end_col = data->cols - 1;
-    if(data->para_mode ==0){
-        start_row= data->row_partition_info[id][0];
-        end_row = data->row_partition_info[id][1];
-    }else{
-        start_col= data->col_partition_info[id][0];
-        end_col = data->col_partition_info[id][1];
+
+/* This function picks the tile a thread works through at a time. In
+ * para_mode 2 a tile is the largest square whose current and next cells
+ * (plus the rows above and below it) fit in half of L2, leaving the rest
+ * for everything else; in the strip modes a tile is the whole board and the
+ * loop is the same as walking the strip row by row.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void size_tiles(struct gol_data *data){
+    int cols = data->engine == ENGINE_BITPACK ? data->words_per_row : data->cols;
+    int cell_bytes = data->engine == ENGINE_BITPACK ? sizeof(uint64_t) : sizeof(int);
+
+    data->tile_rows = data->rows;
+    data->tile_cols = cols;
+    data->tiles_down = 1;
+    data->tiles_across = 1;
+    if(data->para_mode != PARA_TILES && data->para_mode != PARA_STEAL){
+        return;
     }
-     
-    // printf("Starting Row: %d\n",start_row);
-    // printf("Ending Row: %d\n",end_row);
-    // printf("Starting Col: %d\n",start_col);
-    // printf("Ending Col: %d\n",end_col);
-    //could call outside of this function
-    //assume that we're focusing on rows
-    if(data->print_info ==1){
-    printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", id, start_row, end_row, end_row-start_row+1, start_col, end_col, end_col - start_col +1);
-    }   
-    //Process the partition of the game board assigned to this thread
-    for(int a = 0; a<data->rounds; a++){
-        total_live = 0;
-        for(int i = start_row; i <= end_row; i++){
-            for(int j = start_col; j < end_col; j++){
-                int live_neighbors = count_alive(data, i, j);
-                make_alive(data, i, j, live_neighbors); 
-            }
-        }
-    //Barrier to wait for all threads to finish
-    //the next few lines can be printed by the thread with startCol 0, startRow 0
-
-    // replaces the current board with next board
-    int *temp = data->current;
-    data->current = data->next;
-    data->next = temp;
-    //If the output_mode is 1 then the program runs the ASCII version
-        if(data->output_mode == 1){
-            system("clear");
-            print_board(data, data->rounds);
-            usleep(SLEEP_USECS);
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if(l2 <= 0){
+        l2 = DEFAULT_L2_BYTES;
+    }
+    // two boards, half of L2
+    long cells = l2 / 2 / (2 * cell_bytes);
+    int side = 1;
+    while((long)(side + 1) * (side + 1) <= cells){
+        side++;
+    }
+    // a tile a few rows shorter pays for the rows above and below it
+    data->tile_rows = side > 2 ? side - 2 : 1;
+    data->tile_cols = side;
+    if(data->para_mode == PARA_STEAL){
+        // small enough that there is something left to steal: shorten the
+        // tiles first, since a full-width tile streams best, then narrow them
+        long want = (long)STEAL_TILES_PER_THREAD * data->num_threads;
+        if(data->tile_cols > cols){
+            data->tile_cols = cols;
         }
-        
-        //If output_mode is 2 then the program runs the animation version
-        else if(data->output_mode == 2){ 
-            update_colors(data);
-            draw_ready(data->handle);
-            usleep(SLEEP_USECS);
-        } 
+        while(data->tile_rows > 1 && (long)((data->rows + data->tile_rows - 1) / data->tile_rows)
+                * ((cols + data->tile_cols - 1) / data->tile_cols) < want){
+            data->tile_rows--;
+        }
+        while(data->tile_cols > 1 && (long)((data->rows + data->tile_rows - 1) / data->tile_rows)
+                * ((cols + data->tile_cols - 1) / data->tile_cols) < want){
+            data->tile_cols = (data->tile_cols + 1) / 2;
+        }
+        data->tiles_down = (data->rows + data->tile_rows - 1) / data->tile_rows;
+        data->tiles_across = (cols + data->tile_cols - 1) / data->tile_cols;
+    }
+    if(data->print_info == 1){
+        printf("L2: %ld bytes, tiles: %d rows x %d %s\n", l2, data->tile_rows,
+                data->tile_cols, data->engine == ENGINE_BITPACK ? "words" : "cols");
     }
-    return NULL;   
-    //pthread_exit(NULL);
 }
 
-/* the gol application main loop function:
- *  runs rounds of GOL,
- *    * updates program state for next round (world and total_live)
- *    * performs any animation step based on the output/run mode
- *
- *   data: pointer to a struct gol_data  initialized with
- *         all GOL game playing state
- */
-// void* play_gol(void* args) {
-//     struct gol_data *data;
-//     data = (struct gol_data*) args;
-//     //initializing local variables 
-//     int alive;
-//     int* temp = NULL; 
-    
-//     //Gives each thread the number of rows it reads
-//     printf("Before Math: %d\n",data->num_threads);
-//     data->rows_per_thread = data->rows / data->num_threads;
-//     rt = data->rows %data->num_threads;
-//     //LOCK
-//     pthread_mutex_lock(&mutex);
-//     data->start_row = sr_count;
-//     if(rt!=0){
-//         rt--;
-//         data->rows_per_thread ++;
-//     }
-//     for(int a = 0; a<data->rows_per_thread; a++){
-//         sr_count++;
-//     }
-//     pthread_mutex_unlock(&mutex);
-//     printf("%d\n", data->start_row);
-//     //UNLOCK
-//     /*
-
-
-//     // for-loop for the number of rounds of the games
-//     for(int z=1;z<(data->iters)+1;z++){
-//         total_live = 0; 
-//         for(int i=0;i<data->rows;i++){
-//             for(int j=0;j<data->cols;j++){
-//                 alive = count_alive(data,i,j);
-//                 make_alive(data,i,j, alive);
-//             }   
-//         }
-
-//         //Swaps the current with next board
-//         temp = data->current;
-//         data->current = data->next;
-//         data->next = temp;
-
-//         //If the output_mode is 1 then the program runs the ASCII version
-//         if(data->output_mode == 1){
-//             system("clear");
-//             print_board(data, z);
-//             usleep(SLEEP_USECS);
-//         }
-        
-//         //If output_mode is 2 then the program runs the animation version
-//         else if(data->output_mode == 2){ 
-//             update_colors(data);
-//             draw_ready(data->handle);
-//             usleep(SLEEP_USECS);
-//         } 
-//     }
-
-
-//     */
+/* This function pins the calling thread to a core, so that the pages it
+ * first-touches stay on its NUMA node and it keeps its caches. Thread i
+ * gets the i-th core the process is allowed to run on, wrapping around when
+ * there are more threads than cores.
+ * id: the logical ID of the calling thread
+ * returns: none */
+void pin_thread(int id){
+    cpu_set_t allowed, mine;
+    int ncpus;
 
-//     return NULL;
-// }
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0){
+        return;
+    }
+    ncpus = CPU_COUNT(&allowed);
+    if(ncpus == 0){
+        return;
+    }
+    int want = id % ncpus;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        if(!CPU_ISSET(cpu, &allowed)){
+            continue;
+        }
+        if(want-- == 0){
+            CPU_ZERO(&mine);
+            CPU_SET(cpu, &mine);
+            pthread_setaffinity_np(pthread_self(), sizeof(mine), &mine);
+            return;
+        }
+    }
+}
 
-   
-/* This functions counts the alive neighbors around each individual cell
+/* This function zeroes the calling thread's block of both boards, which is
+ * the first write to those pages, so Linux places them on the thread's NUMA
+ * node. Blocks on the edge of the dense board take the halo next to them.
  * data: the struct of type struct gol_data
- * x_axis: x coordinate of a cell
- * y_axis: y coordinate of a cell
- * returns: alive, is of type int, and the number of alive cells*/
-int count_alive(struct gol_data *data, int x_axis, int y_axis){
-    //initializing local variables
-    int x_neigbor;
-    int y_neighbor;
-    int alive = 0;
-
-    for (int x=-1; x < 2; x++) {
-        //calculates the x-coordinate of a neigboring point 
-        x_neigbor = (x + x_axis + data->rows)% data->rows;
-        for (int y=-1; y < 2; y++) {
-            //calculates the y-coordinate of a neigboring point
-            y_neighbor = (y + y_axis + data->cols)% data->cols;
-            if(!((x == 0) && (y == 0))){
-                if(data->current[(x_neigbor*data->cols) + y_neighbor] == 1){
-                    alive +=1;
-                }
-            }
+ * row0, row1: the first and last row of the block
+ * col0, col1: the first and last column (word, for bitpack) of the block
+ * returns: none */
+void first_touch(struct gol_data *data, int row0, int row1, int col0, int col1){
+    if(row1 < row0 || col1 < col0){
+        return;
+    }
+    if(data->engine == ENGINE_BITPACK){
+        size_t len = sizeof(uint64_t) * (col1 - col0 + 1);
+        for(int i = row0; i <= row1; i++){
+            memset(data->bcurrent + (size_t)i * data->words_per_row + col0, 0, len);
+            memset(data->bnext + (size_t)i * data->words_per_row + col0, 0, len);
         }
+        return;
+    }
+    // padded coordinates, taking the halo along on the edges
+    int prow0 = row0 == 0 ? 0 : row0 + 1;
+    int prow1 = row1 == data->rows - 1 ? data->rows + 1 : row1 + 1;
+    int pcol0 = col0 == 0 ? 0 : col0 + 1;
+    int pcol1 = col1 == data->cols - 1 ? data->cols + 1 : col1 + 1;
+    size_t len = sizeof(int) * (pcol1 - pcol0 + 1);
+    for(int i = prow0; i <= prow1; i++){
+        memset(data->current + (size_t)i * data->stride + pcol0, 0, len);
+        memset(data->next + (size_t)i * data->stride + pcol0, 0, len);
     }
-    return alive;
 }
 
-/* This function determines whether a cell changes status (dead or alive) based on its 
-   number of alive neighbors.
-
+/* This function places the live cells that init_game_data_from_args()
+ * saved on the board, once the threads have first-touched it.
  * data: the struct of type struct gol_data
- * x_axis: x coordinate of a cell
- * y_axis: y coordinate of a cell
- * alive: of type int. number of alive cells
  * returns: none */
-void make_alive(struct gol_data *data, int x_axis, int y_axis, int alive){
-    if(data->current[(x_axis*data->cols) + y_axis] == 1){
-
-        if (alive <= 1){
-            data->next[(x_axis*data->cols) + y_axis] = 0;
-        }
-        else if(alive <=3){
-            data->next[(x_axis*data->cols) + y_axis] = 1;
-            total_live++;
+void place_initial_cells(struct gol_data *data){
+    for(long long i = 0; i < data->num_alive_cells; i++){
+        int x = data->initial_cells[2*i];
+        int y = data->initial_cells[2*i + 1];
+        if(data->engine == ENGINE_BITPACK){
+            data->bcurrent[(size_t)x*data->words_per_row + y/BITS_PER_WORD] |=
+                (uint64_t)1 << (y % BITS_PER_WORD);
+        }else{
+            data->current[(size_t)(x+1)*data->stride + (y+1)] = 1;
         }
-        else{
-            data->next[(x_axis*data->cols) + y_axis] = 0;
-        }                
     }
-    else{  
-        if(alive == 3){
-            data->next[(x_axis*data->cols) + y_axis] = 1;
-            total_live++; 
-        } 
+    if(data->engine == ENGINE_DENSE){
+        refresh_halo(data, data->current);
     }
+    free(data->initial_cells);
+    data->initial_cells = NULL;
 }
-/* This function updates the color od the cells in the VISI animation
+
+/* This function makes the 64 cells of one word of the --random board. It
+ * is a counter-based generator: every random word is the SplitMix64
+ * finalizer of the seed and the word's position, so any thread (or
+ * process) can make any part of the board on its own, in any order, and
+ * always gets the same cells. Each cell is alive with chance
+ * random_density / 2^RANDOM_BITS: going up the bits of the density from
+ * the lowest one set, a 1 bit ORs in a fresh random word and a 0 bit ANDs
+ * one in, which halves the chance and adds 1/2 or not at every step.
  * data: the struct of type struct gol_data
- * returns: none */
-void update_colors(struct gol_data* data){
-  int i, j, r, c, index, buff_i;
-    color3 *buff;
+ * r: the row
+ * w: the word in the row (cells 64 w to 64 w + 63)
+ * returns: the word, with the cells past the last column dead */
+uint64_t random_word(struct gol_data *data, int r, int w){
+    uint32_t density = data->random_density;
+    uint64_t counter = ((uint64_t)r * data->words_per_row + w) * RANDOM_BITS;
+    uint64_t bits = 0;
 
-    buff = data->image_buff;  
-    r = data->rows;
-    c = data->cols;
+    if(density >= (1u << RANDOM_BITS)){
+        bits = ~(uint64_t)0;
+    }else if(density > 0){
+        for(int k = __builtin_ctz(density); k < RANDOM_BITS; k++){
+            uint64_t z = data->random_seed * 0x9e3779b97f4a7c15ULL + counter + k;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            bits = (density >> k) & 1 ? bits | z : bits & z;
+        }
+    }
+    if(w == data->words_per_row - 1){
+        bits &= data->last_mask;
+    }
+    return bits;
+}
 
-    for (i = 0; i < r; i++) {
-        for (j = 0; j < c; j++) {
-            index = i*c + j;
-            buff_i = (r - (i+1))*c + j;
+/* This function fills a thread's block of a --random board: row by row,
+ * it first-touches the row of both boards like first_touch() and then
+ * writes its live cells into current, so the pages land on the thread's
+ * NUMA node and each row is still in cache when it is filled.
+ * data: the struct of type struct gol_data
+ * row0, row1: the first and last row of the block
+ * col0, col1: the first and last column (word, for bitpack) of the block
+ * returns: the live cells in the block */
+long long random_fill(struct gol_data *data, int row0, int row1, int col0, int col1){
+    long long live = 0;
 
-            // update animation buffer
-            if (data->current[index] == 0) {
-                buff[buff_i] = c3_red;
-            } else if (data->current[index] == 1) {
-                buff[buff_i] = c3_green;
+    for(int i = row0; i <= row1 && col0 <= col1; i++){
+        first_touch(data, i, i, col0, col1);
+        if(data->engine == ENGINE_BITPACK){
+            uint64_t *row = data->bcurrent + (size_t)i * data->words_per_row;
+            for(int w = col0; w <= col1; w++){
+                row[w] = random_word(data, i, w);
+                live += __builtin_popcountll(row[w]);
+            }
+            continue;
+        }
+        int *row = data->current + (size_t)(i + 1) * data->stride + 1;
+        for(int w = col0 / BITS_PER_WORD; w <= col1 / BITS_PER_WORD; w++){
+            uint64_t bits = random_word(data, i, w);
+            int c0 = w * BITS_PER_WORD > col0 ? w * BITS_PER_WORD : col0;
+            int c1 = w * BITS_PER_WORD + BITS_PER_WORD - 1 < col1
+                ? w * BITS_PER_WORD + BITS_PER_WORD - 1 : col1;
+            for(int c = c0; c <= c1; c++){
+                row[c] = (bits >> (c % BITS_PER_WORD)) & 1;
+                live += row[c];
             }
-     
         }
     }
+    return live;
+}
 
+/* Returns the number of cells in a rectangle of the board; for bitpack
+ * the columns are words, and the last word may be only partly the board */
+static long long tile_cells(struct gol_data *data, int row0, int row1, int col0, int col1){
+    long long width = col1 - col0 + 1;
+    if(data->engine == ENGINE_BITPACK){
+        long long last = (long long)(col1 + 1) * 64 < data->cols ? (long long)(col1 + 1) * 64 : data->cols;
+        width = last - (long long)col0 * 64;
+    }
+    return (long long)(row1 - row0 + 1) * width;
 }
 
-/* This function prints the board to the terminal.
+/* This function advances one rectangle of the board by one generation.
  * data: the struct of type struct gol_data
- * rounds: type int. Number of rounds 
- * returns: none */
-void print_board(struct gol_data *data, int round) {
-
-    int i, j;
-
-    /* Print the round number. */
-    fprintf(stderr, "Round: %d\n", round);
-
-    for (i = 0; i < data->rows; ++i) {
-        for (j = 0; j < data->cols; ++j) {
-            if (data->current[i*data->cols + j]){
-                fprintf(stderr, " @");
-            }
-            else{
-                fprintf(stderr, " .");
+ * row0, row1: the first and last row of the rectangle
+ * col0, col1: the first and last column (word, for bitpack)
+ * returns: the number of live cells written to the next board */
+long long step_tile(struct gol_data *data, int row0, int row1, int col0, int col1){
+    long long live = 0;
+    if(data->thread_stats != NULL && !data->active){
+        data->thread_stats[data->id].cells += tile_cells(data, row0, row1, col0, col1);
+    }
+    if(data->active){
+        return step_active(data, row0, row1, col0, col1);
+    }
+    if(data->cycles != NULL){
+        //each row is compared with its old self while it is still in cache
+        uint64_t hash = 0;
+        for(int i = row0; i <= row1; i++){
+            if(data->engine == ENGINE_BITPACK){
+                live += bitpack_step_row(data, i, col0, col1);
+            }else{
+                live += dense_step_row(data, i, col0, col1);
             }
+            hash ^= row_hash(data, i, col0, col1);
+        }
+        data->live_counts[data->id].hash ^= hash;
+    }else if(data->engine == ENGINE_BITPACK){
+        //for this engine columns are word indices
+        for(int i = row0; i <= row1; i++){
+            live += bitpack_step_row(data, i, col0, col1);
+        }
+    }else{
+        for(int i = row0; i <= row1; i++){
+            live += dense_step_row(data, i, col0, col1);
         }
-        fprintf(stderr, "\n");
     }
+    if(data->visi_dirty){
+        paint_tile(data, row0, row1, col0, col1);
+    }
+    return live;
+}
 
-    /* Print the total number of live cells. */
-    fprintf(stderr, "Live cells: %d\n\n", total_live);
+/* Returns 1 if activity tile (tr, tc) or any of the eight around it
+ * changed in the last generation, wrapping around the edges in a torus. */
+static int tile_is_active(struct gol_data *data, int tr, int tc){
+    for(int dr = -1; dr <= 1; dr++){
+        int r = tr + dr;
+        if(r < 0 || r >= data->active_down){
+            if(data->world != WORLD_TORUS){
+                continue;
+            }
+            r = (r + data->active_down) % data->active_down;
+        }
+        for(int dc = -1; dc <= 1; dc++){
+            int c = tc + dc;
+            if(c < 0 || c >= data->active_across){
+                if(data->world != WORLD_TORUS){
+                    continue;
+                }
+                c = (c + data->active_across) % data->active_across;
+            }
+            if(data->changed[r * data->active_across + c]){
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* This function advances the part of a rectangle of the board that can
+ * change. The rectangle is cut along the activity tiles; a piece whose tile
+ * and neighbor tiles all stayed the same in the last generation is skipped,
+ * since next still holds the generation before, which is the same there.
+ * Every computed piece is compared with current to see if its tile
+ * changed. A rectangle from any partition may cover part of a tile, so the
+ * flag is only ever set, never cleared, here.
+ * The live count of a skipped piece is whatever it was, so rather than a
+ * total this counts the live cells the computed pieces had before into the
+ * thread's old_live, and reduce_live_counts() applies the difference.
+ * data: the struct of type struct gol_data
+ * row0, row1: the first and last row of the rectangle
+ * col0, col1: the first and last column (word, for bitpack)
+ * returns: the number of live cells written to the computed pieces */
+long long step_active(struct gol_data *data, int row0, int row1, int col0, int col1){
+    struct gol_counter *counter = &data->live_counts[data->id];
+    int unit = data->engine == ENGINE_BITPACK ? 1 : ACTIVE_TILE_COLS;
+    long long live = 0;
+
+    for(int r = row0; r <= row1; ){
+        int tr = r / ACTIVE_TILE_ROWS;
+        int r_end = (tr + 1) * ACTIVE_TILE_ROWS - 1 < row1 ? (tr + 1) * ACTIVE_TILE_ROWS - 1 : row1;
+        for(int c = col0; c <= col1; ){
+            int tc = c / unit;
+            int c_end = (tc + 1) * unit - 1 < col1 ? (tc + 1) * unit - 1 : col1;
+            if(!tile_is_active(data, tr, tc)){
+                counter->skipped++;
+                c = c_end + 1;
+                continue;
+            }
+            int changed = 0;
+            if(data->thread_stats != NULL){
+                data->thread_stats[data->id].cells += tile_cells(data, r, r_end, c, c_end);
+            }
+            for(int i = r; i <= r_end; i++){
+                if(data->engine == ENGINE_BITPACK){
+                    const uint64_t *cur = data->bcurrent + (size_t)i * data->words_per_row;
+                    const uint64_t *out = data->bnext + (size_t)i * data->words_per_row;
+                    live += bitpack_step_row(data, i, c, c_end);
+                    for(int w = c; w <= c_end; w++){
+                        counter->old_live += __builtin_popcountll(cur[w]);
+                        changed |= cur[w] != out[w];
+                    }
+                }else{
+                    const int *cur = data->current + (size_t)(i + 1) * data->stride + 1;
+                    const int *out = data->next + (size_t)(i + 1) * data->stride + 1;
+                    live += dense_step_row(data, i, c, c_end);
+                    for(int j = c; j <= c_end; j++){
+                        counter->old_live += cur[j];
+                        changed |= cur[j] != out[j];
+                    }
+                }
+            }
+            if(changed){
+                if(data->cycles != NULL){
+                    for(int i = r; i <= r_end; i++){
+                        counter->hash ^= row_hash(data, i, c, c_end);
+                    }
+                }
+                __atomic_store_n(&data->changed_next[tr * data->active_across + tc], 1, __ATOMIC_RELAXED);
+                if(data->visi_dirty){
+                    paint_tile(data, r, r_end, c, c_end);
+                }
+            }
+            c = c_end + 1;
+        }
+        r = r_end + 1;
+    }
+    return live;
+}
+
+/* This function gives every thread an equal, contiguous run of the tiles
+ * (in row-major tile order) for the next generation, the same split a
+ * static scheduler would use. It is called with no thread computing.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void fill_deques(struct gol_data *data){
+    long long num_tiles = (long long)data->tiles_down * data->tiles_across;
+    for(int i = 0; i < data->num_threads; i++){
+        uint64_t head = num_tiles * i / data->num_threads;
+        uint64_t tail = num_tiles * (i + 1) / data->num_threads;
+        __atomic_store_n(&data->deques[i].range, head | (tail << 32), __ATOMIC_RELAXED);
+    }
+}
+
+/* Takes one tile off the head (owner) or the tail (thief) of a deque.
+ * Returns 1 and the tile number in *tile, or 0 if the deque is empty. */
+static int deque_take(struct gol_deque *deque, int from_tail, int *tile){
+    uint64_t range = __atomic_load_n(&deque->range, __ATOMIC_ACQUIRE);
+    for(;;){
+        uint32_t head = (uint32_t)range;
+        uint32_t tail = (uint32_t)(range >> 32);
+        uint64_t taken;
+        if(head >= tail){
+            return 0;
+        }
+        if(from_tail){
+            tail--;
+            *tile = tail;
+        }else{
+            *tile = head;
+            head++;
+        }
+        taken = head | ((uint64_t)tail << 32);
+        if(__atomic_compare_exchange_n(&deque->range, &range, taken, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+            return 1;
+        }
+    }
+}
+
+/* This function computes the tiles in this thread's deque, front to back,
+ * and then goes around the other threads taking tiles off the back of
+ * theirs. Nothing is added to a deque during a generation, so once a
+ * victim is found empty it stays empty and one pass around is enough.
+ * data: the struct of type struct gol_data
+ * id: the logical ID of the calling thread
+ * returns: the number of live cells this thread wrote to the next board */
+long long run_stealing(struct gol_data *data, int id){
+    long long live = 0;
+    int tile;
+
+    for(int k = 0; k < data->num_threads; k++){
+        int victim = (id + k) % data->num_threads;
+        while(deque_take(&data->deques[victim], victim != id, &tile)){
+            int row0 = (tile / data->tiles_across) * data->tile_rows;
+            int col0 = (tile % data->tiles_across) * data->tile_cols;
+            int row1 = row0 + data->tile_rows - 1;
+            int col1 = col0 + data->tile_cols - 1;
+            int last_col = data->engine == ENGINE_BITPACK ? data->words_per_row - 1 : data->cols - 1;
+            live += step_tile(data, row0, row1 < data->rows - 1 ? row1 : data->rows - 1,
+                    col0, col1 < last_col ? col1 : last_col);
+            data->live_counts[id].tiles++;
+            if(victim != id){
+                data->live_counts[id].steals++;
+            }
+        }
+    }
+    return live;
+}
+
+/********************** Input loading **********************/
+/* Input files are memory-mapped and parsed in place. Three formats are
+ * read:
+ *   text    "rows cols iters num_alive" then one "row col" per live cell
+ *   RLE     the standard run-length pattern format ("x = .., y = ..",
+ *           then runs of b/o ending rows with $ and the pattern with !)
+ *   binary  a struct gol_bin_header, then the board bit-packed exactly
+ *           like the bitpack engine stores it, rows * words_per_row
+ *           64-bit words, so the bitpack engine maps it as its board
+ */
+
+/* Skips spaces, tabs and newlines */
+static inline void input_skip_space(struct gol_input *in){
+    while(in->pos < in->len && (in->buf[in->pos] == ' ' || in->buf[in->pos] == '\t'
+                || in->buf[in->pos] == '\n' || in->buf[in->pos] == '\r')){
+        in->pos++;
+    }
+}
+
+/* Reads a decimal integer into *value; returns 0 if there isn't one */
+static inline int input_int(struct gol_input *in, long long *value){
+    int negative = 0;
+    long long v = 0;
+    input_skip_space(in);
+    if(in->pos < in->len && in->buf[in->pos] == '-'){
+        negative = 1;
+        in->pos++;
+    }
+    if(in->pos >= in->len || in->buf[in->pos] < '0' || in->buf[in->pos] > '9'){
+        return 0;
+    }
+    while(in->pos < in->len && in->buf[in->pos] >= '0' && in->buf[in->pos] <= '9'){
+        v = v * 10 + (in->buf[in->pos] - '0');
+        if(v > INT32_MAX){
+            return 0;
+        }
+        in->pos++;
+    }
+    *value = negative ? -v : v;
+    return 1;
+}
+
+/* Skips to the start of the next line */
+static inline void input_skip_line(struct gol_input *in){
+    while(in->pos < in->len && in->buf[in->pos] != '\n'){
+        in->pos++;
+    }
+    if(in->pos < in->len){
+        in->pos++;
+    }
+}
+
+/* Runs over the body of an RLE pattern starting at in->pos, calling
+ * place_cell() for every live cell when data is not NULL, and returns the
+ * number of live cells. Letters other than b and . are live states. */
+static long long rle_body(struct gol_input *in, struct gol_data *data,
+        int row0, int col0, int width, int height){
+    long long live = 0;
+    long long run;
+    int r = 0, c = 0;
+
+    for(;;){
+        input_skip_space(in);
+        if(in->pos >= in->len){
+            break;
+        }
+        if(!input_int(in, &run)){
+            run = 1;
+        }
+        if(in->pos >= in->len){
+            break;
+        }
+        char tag = in->buf[in->pos++];
+        if(tag == '!'){
+            break;
+        }else if(tag == '$'){
+            r += run;
+            c = 0;
+        }else if(tag == 'b' || tag == '.'){
+            c += run;
+        }else if((tag >= 'a' && tag <= 'z') || (tag >= 'A' && tag <= 'Z')){
+            if(r >= height || c + run > width){
+                printf("Error: RLE pattern is larger than its header says\n");
+                exit(1);
+            }
+            if(data != NULL){
+                for(long long k = 0; k < run; k++){
+                    place_cell(data, row0 + r, col0 + c + k, live + k);
+                }
+            }
+            c += run;
+            live += run;
+        }else{
+            printf("Error: improper RLE file format.\n");
+            exit(1);
+        }
+    }
+    return live;
+}
+
+/* This function memory-maps the input file, works out its format and
+ * reads its header: rows, cols, iters and the number of live cells (which
+ * for RLE and binary files is counted here, so the cells can be stored
+ * without growing anything later).
+ * data: the struct of type struct gol_data
+ * path: the input file
+ * in: the mapped input, for read_cells() and close_input()
+ * returns: none */
+void open_input(struct gol_data *data, const char *path, struct gol_input *in){
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0 || fstat(fd, &st) != 0){
+        printf("Error unable to open file %s\n", path);
+        exit(1);
+    }
+    in->len = st.st_size;
+    in->pos = 0;
+    in->buf = NULL;
+    if(in->len > 0){
+        // private and writable, so a binary board can be mapped as the
+        // bitpack engine's current board and written over later
+        in->buf = mmap(NULL, in->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(in->buf == MAP_FAILED){
+            printf("Error unable to map file %s\n", path);
+            exit(1);
+        }
+        madvise(in->buf, in->len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    if(in->len >= sizeof(struct gol_bin_header) && memcmp(in->buf, GOL_BIN_MAGIC, 8) == 0){
+        const struct gol_bin_header *h = (const struct gol_bin_header*)in->buf;
+        in->format = INPUT_BINARY;
+        data->rows = h->rows;
+        data->cols = h->cols;
+        data->iters = h->iters;
+        data->generation0 = h->generation;
+        in->words_per_row = (h->cols + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        if(h->rows <= 0 || h->cols <= 0 || in->len != sizeof(struct gol_bin_header)
+                + sizeof(uint64_t) * (size_t)h->rows * in->words_per_row){
+            printf("Error: improper binary file format.\n");
+            exit(1);
+        }
+        const uint64_t *words = (const uint64_t*)(in->buf + sizeof(struct gol_bin_header));
+        long long live = 0;
+        for(size_t w = 0; w < (size_t)h->rows * in->words_per_row; w++){
+            live += __builtin_popcountll(words[w]);
+        }
+        data->num_alive_cells = live;
+        return;
+    }
+
+    // RLE: comment lines start with #, then the x = .., y = .. header
+    while(in->pos < in->len && in->buf[in->pos] == '#'){
+        input_skip_line(in);
+    }
+    input_skip_space(in);
+    if(in->pos < in->len && in->buf[in->pos] == 'x'){
+        long long width = 0, height = 0;
+        in->format = INPUT_RLE;
+        for(int field = 0; field < 2; field++){
+            while(in->pos < in->len && in->buf[in->pos] != '=' && in->buf[in->pos] != '\n'){
+                in->pos++;
+            }
+            in->pos++;
+            if(!input_int(in, field == 0 ? &width : &height)){
+                printf("Error: improper RLE file format.\n");
+                exit(1);
+            }
+        }
+        input_skip_line(in);
+        in->width = width;
+        in->height = height;
+        data->cols = width;
+        data->rows = height;
+        data->iters = -1;
+        in->body = in->pos;
+        data->num_alive_cells = rle_body(in, NULL, 0, 0, width, height);
+        return;
+    }
+
+    long long header[4];
+    in->format = INPUT_TEXT;
+    for(int i = 0; i < 4; i++){
+        if(!input_int(in, &header[i])){
+            printf("Error: improper file format.\n");
+            exit(1);
+        }
+    }
+    data->rows = header[0];
+    data->cols = header[1];
+    data->iters = header[2];
+    data->num_alive_cells = header[3];
+}
+
+/* This function places every live cell of the input on the board, or
+ * leaves it where it is if the binary board was mapped as the bitpack
+ * engine's board.
+ * data: the struct of type struct gol_data
+ * in: the input opened by open_input()
+ * returns: none */
+void read_cells(struct gol_data *data, struct gol_input *in){
+    long long x, y;
+
+    if(in->format == INPUT_TEXT){
+        for(long long i = 0; i < data->num_alive_cells; i++){
+            if(!input_int(in, &x) || !input_int(in, &y)
+                    || x < 0 || x >= data->rows || y < 0 || y >= data->cols){
+                printf("Error Improper file format.\n");
+                exit(1);
+            }
+            place_cell(data, x, y, i);
+        }
+    }else if(in->format == INPUT_RLE){
+        // a board bigger than the pattern (--size) gets it in the middle
+        in->pos = in->body;
+        rle_body(in, data, (data->rows - in->height) / 2,
+                (data->cols - in->width) / 2, in->width, in->height);
+    }else if(data->mapped_board == NULL){
+        const uint64_t *words = (const uint64_t*)(in->buf + sizeof(struct gol_bin_header));
+        long long i = 0;
+        for(int r = 0; r < data->rows; r++){
+            for(int w = 0; w < in->words_per_row; w++){
+                uint64_t word = words[(size_t)r * in->words_per_row + w];
+                while(word != 0){
+                    int c = w * BITS_PER_WORD + __builtin_ctzll(word);
+                    if(c >= data->cols){
+                        printf("Error: improper binary file format.\n");
+                        exit(1);
+                    }
+                    place_cell(data, r, c, i++);
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+}
+
+/* This function unmaps the input file, unless the bitpack engine is
+ * using it as its board, in which case main() unmaps it at the end.
+ * data: the struct of type struct gol_data
+ * in: the input opened by open_input()
+ * returns: none */
+void close_input(struct gol_data *data, struct gol_input *in){
+    if(data->mapped_board != NULL){
+        data->input_map = in->buf;
+        data->input_map_len = in->len;
+    }else if(in->buf != NULL){
+        munmap(in->buf, in->len);
+    }
+}
+
+/* This function puts one live cell of the input on the board, or on the
+ * list of cells to place later (para_mode 2, HashLife, sparse).
+ * data: the struct of type struct gol_data
+ * x, y: the cell's row and column
+ * i: the cell's number in the input
+ * returns: none */
+void place_cell(struct gol_data *data, int x, int y, long long i){
+    if(data->initial_cells != NULL){
+        data->initial_cells[2*i] = x;
+        data->initial_cells[2*i + 1] = y;
+    }else if(data->engine == ENGINE_BITPACK){
+        data->bcurrent[(size_t)x*data->words_per_row + y/BITS_PER_WORD] |=
+            (uint64_t)1 << (y % BITS_PER_WORD);
+    }else{
+        data->current[(size_t)(x+1)*data->stride + (y+1)] = 1;
+    }
+}
+
+/********************** Checkpoints **********************/
+/* Checkpoints are binary board files (see open_input()), so a checkpoint
+ * can be given back as the input file, or with --resume, to carry on from
+ * the generation it holds. When one is due, thread 0 claims one of two
+ * snapshot buffers in the serial step of a generation; after the second
+ * barrier every thread packs its strip of rows into it, and after one
+ * more barrier thread 0 hands it to a writer thread, which writes it out
+ * to FILE.tmp, syncs it and renames it over FILE. So the copy is split
+ * across the threads, the compute threads never wait on the disk and
+ * FILE is always a whole checkpoint. If both buffers are still being
+ * written the checkpoint is skipped rather than stalling the simulation.
+ */
+
+/* Writes one snapshot to the checkpoint file; returns 0 on success */
+static int checkpoint_write(struct gol_checkpointer *ck, struct gol_snapshot *snap){
+    struct gol_bin_header header;
+    size_t words = (size_t)ck->rows * ck->words_per_row;
+    char *tmp_path = malloc(strlen(ck->path) + 5);
+    FILE *file;
+    int ok;
+
+    if(tmp_path == NULL){
+        return 1;
+    }
+    sprintf(tmp_path, "%s.tmp", ck->path);
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GOL_BIN_MAGIC, 8);
+    header.rows = ck->rows;
+    header.cols = ck->cols;
+    header.iters = ck->iters;
+    header.generation = snap->generation;
+    header.population = snap->population;
+
+    file = fopen(tmp_path, "wb");
+    ok = file != NULL
+        && fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(snap->words, sizeof(uint64_t), words, file) == words
+        && fflush(file) == 0
+        && fsync(fileno(file)) == 0;
+    if(file != NULL){
+        ok = (fclose(file) == 0) && ok;
+    }
+    ok = ok && rename(tmp_path, ck->path) == 0;
+    free(tmp_path);
+    return !ok;
+}
+
+/* The writer thread: writes READY snapshots, oldest first, until told to
+ * stop and there is nothing left to write */
+static void* checkpoint_writer(void *arg){
+    struct gol_checkpointer *ck = arg;
+
+    pthread_mutex_lock(&ck->lock);
+    for(;;){
+        struct gol_snapshot *snap = NULL;
+        for(int i = 0; i < 2; i++){
+            if(ck->snap[i].state == SNAP_READY
+                    && (snap == NULL || ck->snap[i].generation < snap->generation)){
+                snap = &ck->snap[i];
+            }
+        }
+        if(snap == NULL){
+            if(ck->quit){
+                break;
+            }
+            pthread_cond_wait(&ck->cond, &ck->lock);
+            continue;
+        }
+        snap->state = SNAP_WRITING;
+        pthread_mutex_unlock(&ck->lock);
+        int failed = checkpoint_write(ck, snap);
+        pthread_mutex_lock(&ck->lock);
+        if(failed){
+            printf("Error: could not write checkpoint %s\n", ck->path);
+            ck->failed++;
+        }else{
+            ck->written++;
+        }
+        snap->state = SNAP_FREE;
+    }
+    pthread_mutex_unlock(&ck->lock);
+    return NULL;
+}
+
+/* This function sets up the snapshot buffers and starts the writer thread,
+ * if --checkpoint was given.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void checkpoint_start(struct gol_data *data){
+    struct gol_checkpointer *ck = data->checkpoint;
+    if(ck == NULL){
+        return;
+    }
+    ck->rows = data->rows;
+    ck->cols = data->cols;
+    ck->iters = data->iters;
+    ck->words_per_row = data->words_per_row;
+    ck->filling = NULL;
+    for(int i = 0; i < 2; i++){
+        ck->snap[i].words = malloc(sizeof(uint64_t) * (size_t)data->rows * data->words_per_row);
+        ck->snap[i].state = SNAP_FREE;
+        if(ck->snap[i].words == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ck->last);
+    pthread_mutex_init(&ck->lock, NULL);
+    pthread_cond_init(&ck->cond, NULL);
+    if(pthread_create(&ck->thread, NULL, checkpoint_writer, ck) != 0){
+        printf("pthread_created failed\n");
+        exit(1);
+    }
+}
+
+/* This function claims a snapshot buffer for the current board if a
+ * checkpoint is due, every ck->every generations and/or every ck->secs
+ * seconds; the threads fill it with checkpoint_pack() after the second
+ * barrier. Only thread 0 calls it, in the serial step, when current is
+ * the finished generation.
+ * data: the struct of type struct gol_data
+ * generation: the generation current holds
+ * returns: none */
+void checkpoint_maybe(struct gol_data *data, long long generation){
+    struct gol_checkpointer *ck = data->checkpoint;
+    struct gol_snapshot *snap = NULL;
+    struct timespec now;
+    int due = 0;
+
+    if(ck->every > 0 && generation % ck->every == 0){
+        due = 1;
+    }
+    if(ck->secs > 0){
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if((now.tv_sec - ck->last.tv_sec) + (now.tv_nsec - ck->last.tv_nsec) / 1e9 >= ck->secs){
+            due = 1;
+        }
+    }
+    if(!due){
+        return;
+    }
+
+    pthread_mutex_lock(&ck->lock);
+    for(int i = 0; i < 2 && snap == NULL; i++){
+        if(ck->snap[i].state == SNAP_FREE){
+            snap = &ck->snap[i];
+            snap->state = SNAP_FILLING;
+        }
+    }
+    if(snap == NULL){
+        ck->skipped++;
+    }
+    pthread_mutex_unlock(&ck->lock);
+    if(snap == NULL){
+        return;
+    }
+    snap->generation = generation;
+    snap->population = total_live;
+    clock_gettime(CLOCK_MONOTONIC, &ck->last);
+    ck->filling = snap;
+}
+
+/* This function packs the calling thread's strip of rows of the current
+ * board into the snapshot checkpoint_maybe() claimed. The strips are
+ * whole rows, whatever the para_mode, so no two threads write the same
+ * word. The copy is outside the lock: the writer leaves FILLING buffers
+ * alone.
+ * data: the struct of type struct gol_data
+ * id: the logical ID of the calling thread
+ * returns: none */
+void checkpoint_pack(struct gol_data *data, int id){
+    int row0 = (int)((long long)data->rows * id / data->num_threads);
+    int row1 = (int)((long long)data->rows * (id + 1) / data->num_threads) - 1;
+    pack_rows(data, data->checkpoint->filling->words, row0, row1);
+}
+
+/* This function hands the snapshot every thread has packed its rows into
+ * to the writer thread. Only thread 0 calls it, once they all have.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void checkpoint_publish(struct gol_data *data){
+    struct gol_checkpointer *ck = data->checkpoint;
+
+    pthread_mutex_lock(&ck->lock);
+    ck->filling->state = SNAP_READY;
+    pthread_cond_signal(&ck->cond);
+    pthread_mutex_unlock(&ck->lock);
+    ck->filling = NULL;
+}
+
+/* This function waits for the writer thread to finish the checkpoints it
+ * has been given, stops it and frees the buffers.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void checkpoint_stop(struct gol_data *data){
+    struct gol_checkpointer *ck = data->checkpoint;
+    if(ck == NULL){
+        return;
+    }
+    pthread_mutex_lock(&ck->lock);
+    ck->quit = 1;
+    pthread_cond_signal(&ck->cond);
+    pthread_mutex_unlock(&ck->lock);
+    pthread_join(ck->thread, NULL);
+    if(data->print_info == 1){
+        printf("checkpoints: %lld written, %lld skipped, %lld failed\n",
+                ck->written, ck->skipped, ck->failed);
+    }
+    pthread_mutex_destroy(&ck->lock);
+    pthread_cond_destroy(&ck->cond);
+    free(ck->snap[0].words);
+    free(ck->snap[1].words);
+    free(ck);
+    data->checkpoint = NULL;
+}
+
+/* This function packs the current board into 64-cells-a-word rows, the
+ * layout of the bitpack engine and the binary board format.
+ * data: the struct of type struct gol_data
+ * words: rows * words_per_row words to fill
+ * returns: none */
+void pack_board(struct gol_data *data, uint64_t *words){
+    pack_rows(data, words, 0, data->rows - 1);
+}
+
+/* This function packs rows row0..row1 of the current board, like
+ * pack_board(), into the same rows of words.
+ * data: the struct of type struct gol_data
+ * words: rows * words_per_row words, of which those rows are filled
+ * row0, row1: the first and last row
+ * returns: none */
+void pack_rows(struct gol_data *data, uint64_t *words, int row0, int row1){
+    size_t offset = (size_t)row0 * data->words_per_row;
+    size_t count = row1 >= row0 ? (size_t)(row1 - row0 + 1) * data->words_per_row : 0;
+
+    if(data->engine == ENGINE_BITPACK){
+        memcpy(words + offset, data->bcurrent + offset, sizeof(uint64_t) * count);
+        return;
+    }
+    memset(words + offset, 0, sizeof(uint64_t) * count);
+    for(int i = row0; i <= row1; i++){
+        uint64_t *out = words + (size_t)i * data->words_per_row;
+        if(data->engine == ENGINE_DENSE){
+            const int *row = data->current + (size_t)(i + 1) * data->stride + 1;
+            for(int j = 0; j < data->cols; j++){
+                out[j / BITS_PER_WORD] |= (uint64_t)row[j] << (j % BITS_PER_WORD);
+            }
+        }else{
+            for(int j = 0; j < data->cols; j++){
+                out[j / BITS_PER_WORD] |= (uint64_t)get_cell(data, i, j) << (j % BITS_PER_WORD);
+            }
+        }
+    }
+}
+
+/********************** Asynchronous rendering **********************/
+/* With --async-render the generation loop never draws or sleeps. When a
+ * frame is due, thread 0 packs the board into a snapshot and hands it to
+ * a render thread through a triple buffer: the producer always owns one
+ * buffer, the renderer one, and the third is the mailbox. Publishing
+ * swaps the producer's buffer with the mailbox, and the renderer swaps
+ * its buffer with the mailbox when the RENDER_FRESH bit says there's
+ * something new, each with one atomic exchange and no locks. A snapshot
+ * the renderer didn't get to before the next one is a dropped frame.
+ */
+
+/* The render thread: draws the newest snapshot at the frame rate until
+ * the run is over and the last snapshot has been drawn. */
+static void* render_thread(void *arg){
+    struct gol_render *rd = (struct gol_render*)arg;
+    struct gol_data *view = &rd->view;
+
+    for(;;){
+        int done = __atomic_load_n(&rd->done, __ATOMIC_ACQUIRE);
+        unsigned int middle = __atomic_load_n(&rd->middle, __ATOMIC_ACQUIRE);
+        if(middle & RENDER_FRESH){
+            middle = __atomic_exchange_n(&rd->middle, rd->front, __ATOMIC_ACQ_REL);
+            rd->front = middle & ~RENDER_FRESH;
+            struct gol_snapshot *snap = &rd->snap[rd->front];
+            // the view is a bitpack board that reads the snapshot
+            view->bcurrent = snap->words;
+            if(view->output_mode == OUTPUT_ASCII){
+                draw_frame(view, snap->generation, snap->population);
+            }else if(view->output_mode == OUTPUT_VISI){
+                update_colors(view);
+                draw_ready(view->handle);
+            }
+            rd->frames++;
+        }else if(done){
+            break;
+        }
+        usleep(rd->frame_usecs);
+    }
+    return NULL;
+}
+
+/* This function sets up the snapshots and starts the render thread, if
+ * --async-render was given and there is something to draw.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void render_start(struct gol_data *data){
+    struct gol_render *rd;
+
+    data->render = NULL;
+    if(!data->async_render || data->output_mode == OUTPUT_NONE
+            || data->engine == ENGINE_HASHLIFE){
+        return;
+    }
+    rd = calloc(1, sizeof(struct gol_render));
+    if(rd == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    for(int i = 0; i < 3; i++){
+        rd->snap[i].words = malloc(sizeof(uint64_t) * (size_t)data->rows * data->words_per_row);
+        if(rd->snap[i].words == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    rd->back = 0;
+    rd->middle = 1;
+    rd->front = 2;
+    rd->frame_usecs = 1000000 / data->fps;
+    rd->last_publish = 0;
+    rd->view = *data;
+    rd->view.engine = ENGINE_BITPACK;
+    data->render = rd;
+    if(pthread_create(&rd->thread, NULL, render_thread, rd) != 0){
+        printf("pthread_created failed\n");
+        exit(1);
+    }
+}
+
+/* This function hands the current board to the render thread if a frame
+ * is due (or force is set). Only thread 0 calls it, in the serial step,
+ * when current is the finished generation.
+ * data: the struct of type struct gol_data
+ * generation: the generation current holds
+ * force: publish even if a frame isn't due yet
+ * returns: none */
+void render_publish(struct gol_data *data, long long generation, int force){
+    struct gol_render *rd = data->render;
+    double now = timing_now();
+    struct gol_snapshot *snap;
+    unsigned int middle;
+
+    if(!force && now - rd->last_publish < rd->frame_usecs / 1e6){
+        return;
+    }
+    rd->last_publish = now;
+    snap = &rd->snap[rd->back];
+    pack_board(data, snap->words);
+    snap->generation = generation;
+    snap->population = total_live;
+    middle = __atomic_exchange_n(&rd->middle, rd->back | RENDER_FRESH, __ATOMIC_ACQ_REL);
+    if(middle & RENDER_FRESH){
+        rd->dropped++;
+    }
+    rd->back = middle & ~RENDER_FRESH;
+    rd->published++;
+}
+
+/* This function waits for the render thread to draw the last snapshot
+ * (the simulation publishes its last generation with force set), stops
+ * the thread and frees the snapshots.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void render_stop(struct gol_data *data){
+    struct gol_render *rd = data->render;
+    if(rd == NULL){
+        return;
+    }
+    __atomic_store_n(&rd->done, 1, __ATOMIC_RELEASE);
+    pthread_join(rd->thread, NULL);
+    if(data->print_info == 1){
+        printf("render: %lld snapshots, %lld frames drawn, %lld dropped\n",
+                rd->published, rd->frames, rd->dropped);
+    }
+    for(int i = 0; i < 3; i++){
+        free(rd->snap[i].words);
+    }
+    free(rd);
+    data->render = NULL;
+}
+
+/********************** Timing **********************/
+
+/* Returns the monotonic clock, in seconds */
+double timing_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* This function records one generation's latency in the histogram. The
+ * buckets are LATENCY_STEP apart on a log scale from LATENCY_FLOOR
+ * seconds, so a percentile read back from them is within that ratio of
+ * the real one, however many generations are run.
+ * lat: the latency histogram
+ * secs: how long the generation took
+ * returns: none */
+void latency_add(struct gol_latency *lat, double secs){
+    int b = 0;
+    if(secs > LATENCY_FLOOR){
+        b = (int)(log(secs / LATENCY_FLOOR) / log(LATENCY_STEP));
+        if(b >= LATENCY_BUCKETS){
+            b = LATENCY_BUCKETS - 1;
+        }
+    }
+    lat->buckets[b]++;
+    if(lat->count == 0 || secs < lat->min){
+        lat->min = secs;
+    }
+    if(lat->count == 0 || secs > lat->max){
+        lat->max = secs;
+    }
+    lat->count++;
+}
+
+/* This function reads the q-th quantile (0 to 1) back out of the latency
+ * histogram, as the middle of the bucket it falls in.
+ * lat: the latency histogram
+ * q: the quantile, e.g. 0.5 for the median
+ * returns: the latency in seconds, or 0 if nothing was recorded */
+double latency_quantile(struct gol_latency *lat, double q){
+    long long want = (long long)ceil(q * lat->count);
+    long long seen = 0;
+    if(lat->count == 0){
+        return 0;
+    }
+    if(want < 1){
+        want = 1;
+    }
+    for(int b = 0; b < LATENCY_BUCKETS; b++){
+        seen += lat->buckets[b];
+        if(seen >= want){
+            double secs = LATENCY_FLOOR * pow(LATENCY_STEP, b + 0.5);
+            return secs < lat->min ? lat->min : (secs > lat->max ? lat->max : secs);
+        }
+    }
+    return lat->max;
+}
+
+/* This function prints the performance report: wall time split into the
+ * load, compute and output phases, throughput, and the min / median / p99
+ * / max generation latency; and appends it to the --report-json and
+ * --report-csv files if they were given.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void print_report(struct gol_data *data){
+    struct gol_timing *t = data->timing;
+    static const char *engines[] = {"dense", "bitpack", "hashlife", "sparse"};
+    double gens_per_sec = t->compute > 0 ? data->rounds / t->compute : 0;
+    double cells_per_sec = gens_per_sec * data->rows * (double)data->cols;
+    double lat_min = t->latency.min;
+    double lat_median = latency_quantile(&t->latency, 0.5);
+    double lat_p99 = latency_quantile(&t->latency, 0.99);
+    double lat_max = t->latency.max;
+    FILE *file;
+
+    fprintf(stdout, "Total time: %0.3f seconds\n", t->run);
+    fprintf(stdout, "Load: %0.6f s  Compute: %0.6f s  Output: %0.6f s\n",
+            t->load, t->compute, t->output);
+    fprintf(stdout, "Generations/s: %0.1f  Cell updates/s: %0.4g\n",
+            gens_per_sec, cells_per_sec);
+    if(t->latency.count > 0){
+        fprintf(stdout, "Generation latency: min %0.3g s  median %0.3g s  p99 %0.3g s  max %0.3g s\n",
+                lat_min, lat_median, lat_p99, lat_max);
+    }
+
+    if(data->report_json != NULL){
+        file = fopen(data->report_json, "w");
+        if(file == NULL){
+            printf("Error unable to open file %s\n", data->report_json);
+        }else{
+            fprintf(file, "{\"engine\": \"%s\", \"rows\": %d, \"cols\": %d, "
+                    "\"threads\": %d, \"para_mode\": %d, \"generations\": %d, "
+                    "\"live_cells\": %lld, \"wall_secs\": %.9f, \"load_secs\": %.9f, "
+                    "\"compute_secs\": %.9f, \"output_secs\": %.9f, "
+                    "\"gens_per_sec\": %.6g, \"cell_updates_per_sec\": %.6g, "
+                    "\"latency_min\": %.9g, \"latency_median\": %.9g, "
+                    "\"latency_p99\": %.9g, \"latency_max\": %.9g}\n",
+                    engines[data->engine], data->rows, data->cols, data->num_threads,
+                    data->para_mode, data->rounds, total_live, t->run, t->load,
+                    t->compute, t->output, gens_per_sec, cells_per_sec,
+                    lat_min, lat_median, lat_p99, lat_max);
+            fclose(file);
+        }
+    }
+    if(data->report_csv != NULL){
+        // one row per run, with the header only when the file is new
+        int is_new = access(data->report_csv, F_OK) != 0;
+        file = fopen(data->report_csv, "a");
+        if(file == NULL){
+            printf("Error unable to open file %s\n", data->report_csv);
+        }else{
+            if(is_new){
+                fprintf(file, "engine,rows,cols,threads,para_mode,generations,live_cells,"
+                        "wall_secs,load_secs,compute_secs,output_secs,gens_per_sec,"
+                        "cell_updates_per_sec,latency_min,latency_median,latency_p99,latency_max\n");
+            }
+            fprintf(file, "%s,%d,%d,%d,%d,%d,%lld,%.9f,%.9f,%.9f,%.9f,%.6g,%.6g,%.9g,%.9g,%.9g,%.9g\n",
+                    engines[data->engine], data->rows, data->cols, data->num_threads,
+                    data->para_mode, data->rounds, total_live, t->run, t->load,
+                    t->compute, t->output, gens_per_sec, cells_per_sec,
+                    lat_min, lat_median, lat_p99, lat_max);
+            fclose(file);
+        }
+    }
+}
+
+/********************** Per-thread stats **********************/
+
+/* This function opens the hardware counters (cycles, instructions and
+ * cache misses, as one group) for the calling thread, and starts them. If
+ * the kernel won't give them to us (no PMU, or perf_event_paranoid too
+ * high), perf_fd is left at -1 and the table just leaves them out.
+ * stats: the calling thread's stats
+ * returns: none */
+void perf_open(struct gol_thread_stats *stats){
+    static const unsigned long long events[PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+    };
+    int fds[PERF_EVENTS];
+    struct perf_event_attr attr;
+
+    stats->perf_fd = -1;
+    for(int i = 0; i < PERF_EVENTS; i++){
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = i == 0;   // the whole group starts with its leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+        if(fds[i] < 0){
+            for(int j = 0; j < i; j++){
+                close(fds[j]);
+            }
+            return;
+        }
+    }
+    // the leader's fd reads and closes the whole group
+    for(int i = 1; i < PERF_EVENTS; i++){
+        stats->perf_member[i - 1] = fds[i];
+    }
+    stats->perf_fd = fds[0];
+    ioctl(stats->perf_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(stats->perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/* This function stops the calling thread's hardware counters, reads them
+ * into its stats and closes them.
+ * stats: the calling thread's stats
+ * returns: none */
+void perf_close(struct gol_thread_stats *stats){
+    struct { uint64_t nr; uint64_t values[PERF_EVENTS]; } group;
+    if(stats->perf_fd < 0){
+        return;
+    }
+    ioctl(stats->perf_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if(read(stats->perf_fd, &group, sizeof(group)) == sizeof(group)){
+        stats->cycles = group.values[0];
+        stats->instructions = group.values[1];
+        stats->cache_misses = group.values[2];
+        stats->perf_ok = 1;
+    }
+    for(int i = 1; i < PERF_EVENTS; i++){
+        close(stats->perf_member[i - 1]);
+    }
+    close(stats->perf_fd);
+    stats->perf_fd = -1;
+}
+
+/* This function prints what every thread did over the whole run -- cells
+ * computed, seconds computing, seconds waiting at the barriers and (with
+ * --perf) its hardware counters -- and which thread held the others up:
+ * the one with the most compute time, and how far it is above the mean.
+ * Thread 0's serial step (halo, live count, output) is shown on its own,
+ * since the other threads spend it waiting at the second barrier.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void print_thread_stats(struct gol_data *data){
+    struct gol_thread_stats *stats = data->thread_stats;
+    int perf = 0;
+    int slowest = 0;
+    double mean = 0;
+
+    for(int i = 0; i < data->num_threads; i++){
+        perf |= stats[i].perf_ok;
+        mean += stats[i].compute;
+        if(stats[i].compute > stats[slowest].compute){
+            slowest = i;
+        }
+    }
+    mean /= data->num_threads;
+    if(data->perf && !perf){
+        printf("hardware counters unavailable (see /proc/sys/kernel/perf_event_paranoid)\n");
+    }
+
+    printf("%4s %14s %11s %11s %11s", "tid", "cells", "compute(s)", "wait(s)", "serial(s)");
+    if(perf){
+        printf(" %15s %6s %13s", "cycles", "IPC", "cache-misses");
+    }
+    printf("\n");
+    for(int i = 0; i < data->num_threads; i++){
+        printf("%4d %14lld %11.6f %11.6f %11.6f", i, stats[i].cells,
+                stats[i].compute, stats[i].wait, stats[i].serial);
+        if(perf){
+            printf(" %15lld %6.2f %13lld", stats[i].cycles,
+                    stats[i].cycles > 0 ? (double)stats[i].instructions / stats[i].cycles : 0,
+                    stats[i].cache_misses);
+        }
+        printf("\n");
+    }
+    if(mean > 0){
+        printf("slowest: tid %d, %.6f s computing, %.1f%% above the mean (max/mean %.3f)\n",
+                slowest, stats[slowest].compute,
+                100 * (stats[slowest].compute / mean - 1), stats[slowest].compute / mean);
+    }
+}
+
+/********************** Temporal blocking **********************/
+/* --temporal K advances the board K generations per pass over memory
+ * instead of one. Each thread cuts its strip into bands of rows small
+ * enough that two copies of a band, with K rows of halo above and below,
+ * fit in L2. A band is copied out of current into a scratch board and
+ * stepped K times between the two scratch boards; every generation the
+ * rows that are still right lose one row at each end, so after K of them
+ * exactly the band is left, and it goes straight into next. The halo rows
+ * are computed once per band on each side, which costs about K / band
+ * rows of extra work, in exchange for reading and writing the board once
+ * every K generations.
+ */
+
+/* This function picks the band height and the deepest block for
+ * --temporal K (or TEMPORAL_AUTO, which starts at 1 and tunes up to
+ * TEMPORAL_MAX_DEPTH).
+ * data: the struct of type struct gol_data
+ * k: the --temporal value
+ * returns: none */
+void temporal_init(struct gol_data *data, int k){
+    struct gol_temporal *t = calloc(1, sizeof(struct gol_temporal));
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long row_bytes = (long)data->words_per_row * sizeof(uint64_t);
+
+    if(t == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    if(l2 <= 0){
+        l2 = DEFAULT_L2_BYTES;
+    }
+    t->k_max = k == TEMPORAL_AUTO ? TEMPORAL_MAX_DEPTH : k;
+    t->k = k == TEMPORAL_AUTO ? 1 : k;
+    t->tuning = k == TEMPORAL_AUTO;
+    t->trial = -1;
+    // two scratch bands in half of L2, and never so short that the halo
+    // is most of the work
+    t->band_rows = l2 / 2 / (2 * row_bytes) - 2 * t->k_max;
+    if(t->band_rows < TEMPORAL_MIN_BAND * t->k_max){
+        t->band_rows = TEMPORAL_MIN_BAND * t->k_max;
+    }
+    data->temporal = t;
+    if(data->print_info == 1){
+        printf("temporal blocking: bands of %d rows, %s%d generations per pass\n",
+                t->band_rows, t->tuning ? "tuning up to " : "", t->k_max);
+    }
+}
+
+/* Returns row r of the current bit-packed board, wrapped around the edges
+ * of a torus, or the all-dead row past the edges of a bounded world */
+static inline const uint64_t *temporal_row(struct gol_data *data, long long r){
+    if(r < 0 || r >= data->rows){
+        if(data->world != WORLD_TORUS){
+            return data->bzero;
+        }
+        r = ((r % data->rows) + data->rows) % data->rows;
+    }
+    return data->bcurrent + (size_t)r * data->words_per_row;
+}
+
+/* This function advances rows row0..row1 of the bit-packed board k
+ * generations, from current into next, one band at a time. The first
+ * generation reads the band and its halo straight from current.
+ * data: the struct of type struct gol_data
+ * row0, row1: the first and last row to advance
+ * k: generations to advance, at most temporal->k_max
+ * scratch: the thread's two scratch boards
+ * returns: the number of live cells in the rows after k generations */
+long long temporal_block(struct gol_data *data, int row0, int row1, int k, uint64_t *scratch){
+    int wpr = data->words_per_row;
+    int rows = data->rows;
+    int band = data->temporal->band_rows;
+    size_t row_bytes = sizeof(uint64_t) * wpr;
+    long long live = 0;
+
+    for(int b0 = row0; b0 <= row1; b0 += band){
+        int b1 = b0 + band - 1 < row1 ? b0 + band - 1 : row1;
+        int n = b1 - b0 + 1 + 2 * k;   // rows in the band with its halo
+        uint64_t *src = scratch;
+        uint64_t *dst = scratch + (size_t)(band + 2 * data->temporal->k_max) * wpr;
+
+        // local row i is board row b0 - k + i
+        for(int s = 1; s <= k; s++){
+            for(int i = s; i < n - s; i++){
+                long long r = b0 - k + i;
+                // the last generation of the band goes straight into next
+                uint64_t *out = s == k ? data->bnext + (size_t)r * wpr : dst + (size_t)i * wpr;
+                if(r < 0 || r >= rows){
+                    if(data->world != WORLD_TORUS){
+                        // past the edge of a bounded world: always dead
+                        memset(out, 0, row_bytes);
+                        continue;
+                    }
+                }
+                int count;
+                if(s == 1){
+                    count = bitpack_step_words(data, temporal_row(data, r - 1),
+                            temporal_row(data, r), temporal_row(data, r + 1), out, 0, wpr - 1);
+                }else{
+                    count = bitpack_step_words(data, src + (size_t)(i - 1) * wpr,
+                            src + (size_t)i * wpr, src + (size_t)(i + 1) * wpr, out, 0, wpr - 1);
+                }
+                if(s == k){
+                    live += count;
+                }
+            }
+            uint64_t *temp = src;
+            src = dst;
+            dst = temp;
+        }
+    }
+    return live;
+}
+
+/* This function times the depths for --temporal auto: after one warm-up
+ * block it runs a block at each power of two up to k_max, then keeps the
+ * one with the least time per generation. It is called by thread 0 in the
+ * serial step.
+ * data: the struct of type struct gol_data
+ * k: the depth of the block that just ran (shorter than temporal->k at
+ *    the end of the run or before a checkpoint)
+ * secs: how long it took
+ * returns: none */
+void temporal_tune(struct gol_data *data, int k, double secs){
+    struct gol_temporal *t = data->temporal;
+
+    if(t->trial++ < 0 || k != t->k){
+        return;   // the first block pays for faulting next in
+    }
+    if(t->best_k == 0 || secs / k < t->best){
+        t->best = secs / k;
+        t->best_k = k;
+    }
+    if(t->k * 2 <= t->k_max){
+        t->k *= 2;
+    }else{
+        t->k = t->best_k;
+        t->tuning = 0;
+    }
+}
+
+/********************** Multi-process mode **********************/
+/* --procs N splits the board into N row blocks, the same split as
+ * para_mode 0, and forks a process for each. A process copies its rows of
+ * the board into a board of its own with one halo row above and below,
+ * and from then on shares no memory with the others: every generation it
+ * sends its first row to the block above and its last row to the block
+ * below, over a socketpair to each, and gets their edge rows back as its
+ * halo. The sends go out first and the rows that don't touch the halo are
+ * computed while they are in flight; only the two edge rows wait for the
+ * neighbors. Since each block only ever talks to its neighbors over a
+ * byte stream, the same code would work with the processes on different
+ * machines and TCP sockets in place of the socketpairs.
+ */
+
+/* This function moves the halo rows along until every send and receive
+ * is done, or, if wait is 0, as far as they go without blocking.
+ * halos: the links to the block above and the block below
+ * row_bytes: the size of a row
+ * wait: 1 to block until both rows are across both ways
+ * returns: none */
+static void halo_progress(struct gol_halo *halos, size_t row_bytes, int wait){
+    for(;;){
+        struct pollfd fds[2];
+        int n = 0;
+        for(int i = 0; i < 2; i++){
+            struct gol_halo *h = &halos[i];
+            if(h->fd < 0){
+                continue;
+            }
+            while(h->sent < row_bytes){
+                ssize_t got = send(h->fd, h->send + h->sent, row_bytes - h->sent, MSG_DONTWAIT);
+                if(got <= 0){
+                    break;
+                }
+                h->sent += got;
+            }
+            while(h->received < row_bytes){
+                ssize_t got = recv(h->fd, h->recv + h->received, row_bytes - h->received,
+                        MSG_DONTWAIT);
+                if(got == 0){
+                    printf("Error: a neighbor process exited\n");
+                    _exit(1);
+                }
+                if(got < 0){
+                    break;
+                }
+                h->received += got;
+            }
+            if(h->sent < row_bytes || h->received < row_bytes){
+                fds[n].fd = h->fd;
+                fds[n].events = (h->sent < row_bytes ? POLLOUT : 0)
+                    | (h->received < row_bytes ? POLLIN : 0);
+                n++;
+            }
+        }
+        if(n == 0 || !wait){
+            return;
+        }
+        if(poll(fds, n, -1) < 0 && errno != EINTR){
+            printf("Error: poll failed\n");
+            _exit(1);
+        }
+    }
+}
+
+/* This function is one process of --procs: it runs all the rounds on
+ * rows row0..row1 of the board and writes what it found to the parent.
+ * data: the struct of type struct gol_data, with the whole starting board
+ * rank: the process's block number
+ * row0, row1: its rows
+ * up, down: its sockets to the blocks above and below, or -1
+ * result_fd: the pipe to the parent
+ * returns: none */
+static void proc_main(struct gol_data *data, int rank, int row0, int row1,
+        int up, int down, int result_fd){
+    int wpr = data->words_per_row;
+    int n = row1 - row0 + 1;
+    size_t row_bytes = sizeof(uint64_t) * wpr;
+    struct gol_proc_result result;
+    struct gol_halo halos[2];
+    uint64_t *cur = calloc((size_t)(n + 2) * wpr, sizeof(uint64_t));
+    uint64_t *next = calloc((size_t)(n + 2) * wpr, sizeof(uint64_t));
+
+    if(cur == NULL || next == NULL){
+        printf("ERROR: malloc failed!\n");
+        _exit(1);
+    }
+    memset(&result, 0, sizeof(result));
+    result.rank = rank;
+    // local row i + 1 is board row row0 + i; rows 0 and n + 1 are the halo.
+    // A --random board is made here, each process making its own rows.
+    if(data->random_fill){
+        result.live = 0;
+        for(int i = 0; i < n; i++){
+            for(int w = 0; w < wpr; w++){
+                cur[(size_t)(i + 1) * wpr + w] = random_word(data, row0 + i, w);
+                result.live += __builtin_popcountll(cur[(size_t)(i + 1) * wpr + w]);
+            }
+        }
+    }else{
+        memcpy(cur + wpr, data->bcurrent + (size_t)row0 * wpr, row_bytes * n);
+        //only this block's cells, in case there are no rounds to count them
+        for(size_t w = wpr; w < (size_t)(n + 1) * wpr; w++){
+            result.live += __builtin_popcountll(cur[w]);
+        }
+    }
+
+    for(int a = 0; a < data->rounds; a++){
+        double start = timing_now();
+        halos[0] = (struct gol_halo){up, (char*)(cur + wpr), 0, (char*)cur, 0};
+        halos[1] = (struct gol_halo){down, (char*)(cur + (size_t)n * wpr), 0,
+            (char*)(cur + (size_t)(n + 1) * wpr), 0};
+        halo_progress(halos, row_bytes, 0);
+
+        // the inside of the block, while the edge rows are on their way
+        long long live = 0;
+        for(int i = 2; i <= n - 1; i++){
+            live += bitpack_step_words(data, cur + (size_t)(i - 1) * wpr, cur + (size_t)i * wpr,
+                    cur + (size_t)(i + 1) * wpr, next + (size_t)i * wpr, 0, wpr - 1);
+        }
+        double waited = timing_now();
+        halo_progress(halos, row_bytes, 1);
+        result.wait += timing_now() - waited;
+        for(int i = 1; i <= n; i += (n > 1 ? n - 1 : 1)){
+            live += bitpack_step_words(data, cur + (size_t)(i - 1) * wpr, cur + (size_t)i * wpr,
+                    cur + (size_t)(i + 1) * wpr, next + (size_t)i * wpr, 0, wpr - 1);
+        }
+        uint64_t *temp = cur;
+        cur = next;
+        next = temp;
+        result.live = live;
+        result.compute += timing_now() - start;
+    }
+    result.compute -= result.wait;
+    if(write(result_fd, &result, sizeof(result)) != sizeof(result)){
+        _exit(1);
+    }
+    free(cur);
+    free(next);
+}
+
+/* This function runs all the rounds with --procs: it connects the blocks
+ * into a ring of socketpairs (a line, in a bounded world, where the edges
+ * have no neighbor and their halo stays dead), forks a process per block,
+ * and adds up the live cells they send back.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void play_procs(struct gol_data *data){
+    int procs = data->procs;
+    int **blocks = row_partition(data->rows, data->cols, procs, NULL);
+    int (*links)[2] = malloc(sizeof(int[2]) * procs);
+    int result_pipe[2];
+    double start = timing_now();
+    long long live = 0;
+    int failed = 0;
+
+    if(blocks == NULL || links == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    // link i joins the bottom of block i to the top of block i + 1
+    for(int i = 0; i < procs; i++){
+        links[i][0] = links[i][1] = -1;
+        if(i == procs - 1 && data->world != WORLD_TORUS){
+            continue;
+        }
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, links[i]) != 0){
+            printf("Error: socketpair failed\n");
+            exit(1);
+        }
+    }
+    if(pipe(result_pipe) != 0){
+        printf("Error: pipe failed\n");
+        exit(1);
+    }
+    fflush(stdout);
+    for(int i = 0; i < procs; i++){
+        pid_t pid = fork();
+        if(pid < 0){
+            printf("Error: fork failed\n");
+            exit(1);
+        }
+        if(pid == 0){
+            int up = links[(i + procs - 1) % procs][1];
+            int down = links[i][0];
+            for(int j = 0; j < procs; j++){
+                if(links[j][0] >= 0 && links[j][0] != down){
+                    close(links[j][0]);
+                }
+                if(links[j][1] >= 0 && links[j][1] != up){
+                    close(links[j][1]);
+                }
+            }
+            close(result_pipe[0]);
+            proc_main(data, i, blocks[i][0], blocks[i][1], up, down, result_pipe[1]);
+            _exit(0);
+        }
+    }
+    for(int i = 0; i < procs; i++){
+        if(links[i][0] >= 0){
+            close(links[i][0]);
+            close(links[i][1]);
+        }
+    }
+    close(result_pipe[1]);
+
+    for(int i = 0; i < procs; i++){
+        struct gol_proc_result result;
+        if(read(result_pipe[0], &result, sizeof(result)) != sizeof(result)){
+            failed = 1;
+            break;
+        }
+        live += result.live;
+        if(data->print_info == 1){
+            printf("proc %d: rows: %d:%d (%d) compute: %.6f s halo wait: %.6f s\n",
+                    result.rank, blocks[result.rank][0], blocks[result.rank][1],
+                    blocks[result.rank][1] - blocks[result.rank][0] + 1,
+                    result.compute, result.wait);
+        }
+    }
+    close(result_pipe[0]);
+    for(int i = 0; i < procs; i++){
+        int status;
+        if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            failed = 1;
+        }
+    }
+    if(failed){
+        printf("Error: a --procs process failed\n");
+        exit(1);
+    }
+    total_live = live;
+    data->timing->compute = timing_now() - start;
+
+    free(blocks);
+    free(links);
+}
+
+/********************** Cycle detection **********************/
+/* Returns cell number cell's Zobrist key: the splitmix64 mix of its
+ * number, so there is no table of keys to keep in cache */
+static inline uint64_t cell_key(uint64_t cell){
+    uint64_t z = (cell + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Returns the key of bit-packed word number word holding value: the
+ * murmur3 finalizer of the value, offset by the word number. A whole word
+ * is one key, so a busy board costs two mixes per changed word instead of
+ * one per changed cell; an all-dead word has a key too, which XORs out
+ * like any other when the word changes. */
+static inline uint64_t word_key(uint64_t word, uint64_t value){
+    uint64_t z = value ^ (word * 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 33)) * 0xff51afd7ed558ccdULL;
+    z = (z ^ (z >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return z ^ (z >> 33);
+}
+
+/* This function hashes the current board from scratch and makes it the
+ * first generation of the history. After this the threads only update the
+ * hash for the cells that change.
+ * data: the struct of type struct gol_data
+ * cycles: the history to start
+ * returns: none */
+void cycles_start(struct gol_data *data, struct gol_cycles *cycles){
+    uint64_t hash = 0;
+    long long live = 0;
+
+    for(int i = 0; i < data->rows; i++){
+        if(data->engine == ENGINE_BITPACK){
+            const uint64_t *row = data->bcurrent + (size_t)i * data->words_per_row;
+            for(int w = 0; w < data->words_per_row; w++){
+                live += __builtin_popcountll(row[w]);
+                hash ^= word_key((uint64_t)i * data->words_per_row + w, row[w]);
+            }
+        }else{
+            const int *row = data->current + (size_t)(i + 1) * data->stride + 1;
+            for(int j = 0; j < data->cols; j++){
+                if(row[j]){
+                    hash ^= cell_key((uint64_t)i * data->cols + j);
+                    live++;
+                }
+            }
+        }
+    }
+    cycles->hash = hash;
+    cycles->first = data->generation0;
+    cycles->stable_gen = -1;
+    cycles->period = 0;
+    cycles->stop = 0;
+    cycles->hashes[data->generation0 % (cycles->max_period + 1)] = hash;
+    cycles->pops[data->generation0 % (cycles->max_period + 1)] = live;
+}
+
+/* This function returns how the board hash changes with the cells of a
+ * row (columns, or words for bitpack, col0..col1) that differ between
+ * current and next: the XOR of their keys (for a word, its old and new
+ * keys).
+ * data: the struct of type struct gol_data
+ * row: the row
+ * col0, col1: the first and last column (word, for bitpack)
+ * returns: the XOR of the keys of the cells that changed */
+uint64_t row_hash(struct gol_data *data, int row, int col0, int col1){
+    uint64_t hash = 0;
+    uint64_t base = (uint64_t)row * data->cols;
+
+    if(data->engine == ENGINE_BITPACK){
+        const uint64_t *cur = data->bcurrent + (size_t)row * data->words_per_row;
+        const uint64_t *out = data->bnext + (size_t)row * data->words_per_row;
+        base = (uint64_t)row * data->words_per_row;
+        for(int w = col0; w <= col1; w++){
+            if(cur[w] != out[w]){
+                hash ^= word_key(base + w, cur[w]) ^ word_key(base + w, out[w]);
+            }
+        }
+    }else{
+        const int *cur = data->current + (size_t)(row + 1) * data->stride + 1;
+        const int *out = data->next + (size_t)(row + 1) * data->stride + 1;
+        for(int j = col0; j <= col1; j++){
+            if(cur[j] != out[j]){
+                hash ^= cell_key(base + j);
+            }
+        }
+    }
+    return hash;
+}
+
+/* This function records the board hash of a new generation and looks for
+ * it among the last max_period generations, shortest period first. A
+ * match needs the live count to agree too, which makes a false one from
+ * two boards with the same 64-bit hash even less likely.
+ * cycles: the history
+ * generation: the generation the board is at now
+ * live: its live cells
+ * returns: 1 if it repeats generation - period, setting stable_gen and
+ *          period, 0 if not */
+int cycles_record(struct gol_cycles *cycles, long long generation, long long live){
+    int slots = cycles->max_period + 1;
+
+    for(int p = 1; p <= cycles->max_period && p <= generation - cycles->first; p++){
+        int slot = (generation - p) % slots;
+        if(cycles->hashes[slot] == cycles->hash && cycles->pops[slot] == live){
+            cycles->generation = generation;
+            cycles->stable_gen = generation - p;
+            cycles->period = p;
+            return 1;
+        }
+    }
+    cycles->hashes[generation % slots] = cycles->hash;
+    cycles->pops[generation % slots] = live;
+    return 0;
+}
+
+/* This function returns the live cells the board will have at a later
+ * generation, once cycles_record() has found the cycle: every generation
+ * from stable_gen on is one of the period generations in the history.
+ * cycles: the history, with a cycle found
+ * generation: a generation at or after stable_gen
+ * returns: its live cells */
+long long cycles_population(struct gol_cycles *cycles, long long generation){
+    long long g = cycles->stable_gen + (generation - cycles->stable_gen) % cycles->period;
+    return cycles->pops[g % (cycles->max_period + 1)];
+}
+
+/********************** Benchmarks **********************/
+/* ./gol --bench writes synthetic boards to a temporary directory, in the
+ * binary board format, and runs this program on each of them for every
+ * combination of board size, engine, num_threads and para_mode. Every
+ * run is its own process, so one run's heap and page cache state don't
+ * carry over to the next, and each is repeated to get the spread.
+ */
+
+static const char *bench_patterns[BENCH_PATTERNS] = {
+    "random-10", "random-30", "random-60", "gliders", "soup", "methuselahs"
+};
+static const char *bench_engines[] = {"dense", "bitpack", "hashlife", "sparse"};
+
+/* splitmix64: the next number from a 64-bit state, for the synthetic
+ * boards; fixed seeds make every machine benchmark the same boards */
+static uint64_t bench_random(uint64_t *state){
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Sets the cell at (r, c) on a bit-packed board, wrapping around the edges */
+static void bench_set(uint64_t *words, int words_per_row, int size, int r, int c){
+    r %= size;
+    c %= size;
+    words[(size_t)r * words_per_row + c / BITS_PER_WORD] |= (uint64_t)1 << (c % BITS_PER_WORD);
+}
+
+/* This function writes one synthetic size x size board in the binary
+ * board format:
+ *   random-10/30/60  each cell alive with that percent chance
+ *   gliders          one glider in every 32 x 32 block, all heading the
+ *                    same way
+ *   soup             16 x 16 patches at 50% density, one in every
+ *                    64 x 64 block, that burn out into ash
+ *   methuselahs      one acorn (5206 generations on its own) in every
+ *                    128 x 128 block
+ * path: the file to write
+ * pattern: index into bench_patterns
+ * size: rows and columns
+ * iters: the round count to put in the header
+ * returns: none */
+void bench_board(const char *path, int pattern, int size, int iters){
+    static const int glider[5][2] = {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+    static const int acorn[7][2] = {{0, 1}, {1, 3}, {2, 0}, {2, 1}, {2, 4}, {2, 5}, {2, 6}};
+    int words_per_row = (size + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    size_t num_words = (size_t)size * words_per_row;
+    uint64_t *words = calloc(num_words, sizeof(uint64_t));
+    uint64_t state = 0x601f + pattern * 1000003ULL + size;
+    struct gol_bin_header header;
+    FILE *file;
+
+    if(words == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    if(pattern <= 2){
+        uint64_t threshold = (pattern == 0 ? 10 : pattern == 1 ? 30 : 60) * (UINT64_MAX / 100);
+        for(int r = 0; r < size; r++){
+            for(int c = 0; c < size; c++){
+                if(bench_random(&state) < threshold){
+                    bench_set(words, words_per_row, size, r, c);
+                }
+            }
+        }
+    }else if(pattern == 3){
+        for(int r = 0; r < size; r += 32){
+            for(int c = 0; c < size; c += 32){
+                for(int k = 0; k < 5; k++){
+                    bench_set(words, words_per_row, size, r + glider[k][0], c + glider[k][1]);
+                }
+            }
+        }
+    }else if(pattern == 4){
+        for(int r = 0; r < size; r += 64){
+            for(int c = 0; c < size; c += 64){
+                for(int i = 0; i < 16; i++){
+                    uint64_t bits = bench_random(&state);
+                    for(int j = 0; j < 16; j++){
+                        if((bits >> j) & 1){
+                            bench_set(words, words_per_row, size, r + 24 + i, c + 24 + j);
+                        }
+                    }
+                }
+            }
+        }
+    }else{
+        for(int r = 0; r < size; r += 128){
+            for(int c = 0; c < size; c += 128){
+                for(int k = 0; k < 7; k++){
+                    bench_set(words, words_per_row, size, r + 60 + acorn[k][0], c + 60 + acorn[k][1]);
+                }
+            }
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GOL_BIN_MAGIC, 8);
+    header.rows = size;
+    header.cols = size;
+    header.iters = iters;
+    for(size_t w = 0; w < num_words; w++){
+        header.population += __builtin_popcountll(words[w]);
+    }
+    file = fopen(path, "wb");
+    if(file == NULL || fwrite(&header, sizeof(header), 1, file) != 1
+            || fwrite(words, sizeof(uint64_t), num_words, file) != num_words){
+        printf("Error unable to write file %s\n", path);
+        exit(1);
+    }
+    fclose(file);
+    free(words);
+}
+
+/* This function runs this program once on a benchmark board, with no
+ * output, and reads back the cell updates per second from its JSON report.
+ * board: the board file
+ * engine: index into bench_engines
+ * threads, mode: num_threads and para_mode
+ * report: where the run writes its JSON report
+ * returns: cell updates per second, or -1 if the run failed */
+double bench_run(const char *board, int engine, int threads, int mode, const char *report){
+    char threads_arg[16], mode_arg[16], line[1024];
+    double rate = -1;
+    int status;
+    FILE *file;
+    pid_t pid;
+
+    snprintf(threads_arg, sizeof(threads_arg), "%d", threads);
+    snprintf(mode_arg, sizeof(mode_arg), "%d", mode);
+    unlink(report);
+    pid = fork();
+    if(pid < 0){
+        printf("Error: fork failed\n");
+        exit(1);
+    }
+    if(pid == 0){
+        int devnull = open("/dev/null", O_WRONLY);
+        if(devnull >= 0){
+            dup2(devnull, STDOUT_FILENO);
+        }
+        execl("/proc/self/exe", "gol", board, "0", threads_arg, mode_arg, "0",
+                "--engine", bench_engines[engine], "--report-json", report, (char*)NULL);
+        _exit(127);
+    }
+    if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        return -1;
+    }
+    file = fopen(report, "r");
+    if(file == NULL){
+        return -1;
+    }
+    if(fgets(line, sizeof(line), file) != NULL){
+        char *field = strstr(line, "\"cell_updates_per_sec\": ");
+        if(field != NULL){
+            rate = atof(field + strlen("\"cell_updates_per_sec\": "));
+        }
+    }
+    fclose(file);
+    return rate;
+}
+
+/* Reads a comma-separated list of numbers into list; returns how many */
+static int bench_list(const char *arg, int *list, int max){
+    int n = 0;
+    while(*arg != '\0' && n < max){
+        list[n++] = atoi(arg);
+        while(*arg != '\0' && *arg != ','){
+            arg++;
+        }
+        if(*arg == ','){
+            arg++;
+        }
+    }
+    return n;
+}
+
+/* This function is the --bench mode: it runs every pattern in
+ * bench_patterns at every size, engine, thread count and para_mode it was
+ * given, repeats each run, and prints the mean cell updates per second
+ * with the standard deviation, coefficient of variation, min and max.
+ *   --bench-sizes LIST    board sizes (square), default 256,1024,2048
+ *   --bench-threads LIST  num_threads values, default 1 and the number
+ *                         of online CPUs
+ *   --bench-modes LIST    para_modes, default 0,1,2,3
+ *   --bench-engines LIST  engine numbers (0 dense, 1 bitpack, 2 hashlife,
+ *                         3 sparse), default 0,1; the single-threaded
+ *                         engines only run with 1 thread and para_mode 0
+ *   --bench-reps N        repeats of every run, default 3
+ *   --bench-iters N       generations per run, default enough for about
+ *                         BENCH_WORK cell updates
+ *   --bench-csv FILE      also write every result to FILE as CSV
+ * argc, argv: the command line, with --bench at argv[1]
+ * returns: 0, or 1 if any run failed */
+int run_bench(int argc, char **argv){
+    int sizes[BENCH_MAX_LIST] = {256, 1024, 2048};
+    int threads[BENCH_MAX_LIST] = {1, 0};
+    int modes[BENCH_MAX_LIST] = {PARA_ROWS, PARA_COLS, PARA_TILES, PARA_STEAL};
+    int engines[BENCH_MAX_LIST] = {ENGINE_DENSE, ENGINE_BITPACK};
+    int num_sizes = 3, num_threads = 2, num_modes = 4, num_engines = 2;
+    int reps = 3, iters_flag = 0, failed = 0;
+    const char *csv_path = NULL;
+    char dir[] = "/tmp/gol-bench-XXXXXX";
+    char board[64], report[64];
+    FILE *csv = NULL;
+
+    threads[1] = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads[1] <= 1){
+        num_threads = 1;
+    }
+    for(int i = 2; i < argc; i++){
+        if(strcmp(argv[i], "--bench-sizes") == 0 && i + 1 < argc){
+            num_sizes = bench_list(argv[++i], sizes, BENCH_MAX_LIST);
+        }else if(strcmp(argv[i], "--bench-threads") == 0 && i + 1 < argc){
+            num_threads = bench_list(argv[++i], threads, BENCH_MAX_LIST);
+        }else if(strcmp(argv[i], "--bench-modes") == 0 && i + 1 < argc){
+            num_modes = bench_list(argv[++i], modes, BENCH_MAX_LIST);
+        }else if(strcmp(argv[i], "--bench-engines") == 0 && i + 1 < argc){
+            num_engines = bench_list(argv[++i], engines, BENCH_MAX_LIST);
+        }else if(strcmp(argv[i], "--bench-reps") == 0 && i + 1 < argc){
+            reps = atoi(argv[++i]);
+        }else if(strcmp(argv[i], "--bench-iters") == 0 && i + 1 < argc){
+            iters_flag = atoi(argv[++i]);
+        }else if(strcmp(argv[i], "--bench-csv") == 0 && i + 1 < argc){
+            csv_path = argv[++i];
+        }else{
+            printf("Error: unknown option %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    for(int i = 0; i < num_sizes; i++){
+        if(sizes[i] <= 0){
+            printf("Error: --bench-sizes must be positive\n");
+            exit(1);
+        }
+    }
+    for(int i = 0; i < num_threads; i++){
+        if(threads[i] <= 0){
+            printf("Error: --bench-threads must be positive\n");
+            exit(1);
+        }
+    }
+    for(int i = 0; i < num_modes; i++){
+        if(modes[i] < PARA_ROWS || modes[i] > PARA_STEAL){
+            printf("Error: --bench-modes must be 0 to 3\n");
+            exit(1);
+        }
+    }
+    for(int i = 0; i < num_engines; i++){
+        if(engines[i] < ENGINE_DENSE || engines[i] > ENGINE_SPARSE){
+            printf("Error: --bench-engines must be 0 to 3\n");
+            exit(1);
+        }
+    }
+    if(reps < 1){
+        printf("Error: --bench-reps must be at least 1\n");
+        exit(1);
+    }
+    if(mkdtemp(dir) == NULL){
+        printf("Error: unable to make a directory in /tmp\n");
+        exit(1);
+    }
+    snprintf(report, sizeof(report), "%s/report.json", dir);
+    if(csv_path != NULL){
+        csv = fopen(csv_path, "w");
+        if(csv == NULL){
+            printf("Error unable to open file %s\n", csv_path);
+            exit(1);
+        }
+        fprintf(csv, "pattern,size,engine,threads,para_mode,generations,reps,"
+                "mean_cell_updates_per_sec,stddev,cv_percent,min,max\n");
+    }
+
+    printf("%-12s %6s %-8s %7s %4s %6s %12s %10s %6s %12s %12s\n", "pattern", "size",
+            "engine", "threads", "mode", "gens", "updates/s", "stddev", "cv%", "min", "max");
+    for(int s = 0; s < num_sizes; s++){
+        int size = sizes[s];
+        long long gens = iters_flag > 0 ? iters_flag : BENCH_WORK / ((long long)size * size);
+        gens = gens < 4 ? 4 : (gens > 100000 ? 100000 : gens);
+        for(int p = 0; p < BENCH_PATTERNS; p++){
+            snprintf(board, sizeof(board), "%s/board.bin", dir);
+            bench_board(board, p, size, gens);
+            for(int e = 0; e < num_engines; e++){
+                int single = engines[e] == ENGINE_HASHLIFE || engines[e] == ENGINE_SPARSE;
+                for(int t = 0; t < num_threads; t++){
+                    for(int m = 0; m < num_modes; m++){
+                        double sum = 0, sum_sq = 0, min = 0, max = 0;
+                        int ok = 1;
+                        if(single && (threads[t] != 1 || modes[m] != PARA_ROWS)){
+                            continue;
+                        }
+                        for(int r = 0; r < reps; r++){
+                            double rate = bench_run(board, engines[e], threads[t], modes[m], report);
+                            if(rate < 0){
+                                ok = 0;
+                                break;
+                            }
+                            sum += rate;
+                            sum_sq += rate * rate;
+                            min = r == 0 || rate < min ? rate : min;
+                            max = r == 0 || rate > max ? rate : max;
+                        }
+                        if(!ok){
+                            printf("%-12s %6d %-8s %7d %4d %6lld  run failed\n", bench_patterns[p],
+                                    size, bench_engines[engines[e]], threads[t], modes[m], gens);
+                            failed = 1;
+                            continue;
+                        }
+                        double mean = sum / reps;
+                        double var = reps > 1 ? (sum_sq - sum * mean) / (reps - 1) : 0;
+                        double stddev = var > 0 ? sqrt(var) : 0;
+                        double cv = mean > 0 ? 100 * stddev / mean : 0;
+                        printf("%-12s %6d %-8s %7d %4d %6lld %12.4g %10.3g %6.1f %12.4g %12.4g\n",
+                                bench_patterns[p], size, bench_engines[engines[e]], threads[t],
+                                modes[m], gens, mean, stddev, cv, min, max);
+                        fflush(stdout);
+                        if(csv != NULL){
+                            fprintf(csv, "%s,%d,%s,%d,%d,%lld,%d,%.6g,%.6g,%.3f,%.6g,%.6g\n",
+                                    bench_patterns[p], size, bench_engines[engines[e]],
+                                    threads[t], modes[m], gens, reps, mean, stddev, cv, min, max);
+                        }
+                    }
+                }
+            }
+            unlink(board);
+        }
+    }
+    if(csv != NULL){
+        fclose(csv);
+    }
+    unlink(report);
+    rmdir(dir);
+    return failed;
+}
+
+/********************** Batch mode **********************/
+/* ./gol --batch runs a whole list of boards in one process, for workloads
+ * of many small boards where starting a process and a set of threads per
+ * board costs more than the simulation. Each board is a job run start to
+ * finish by one thread of a fixed pool, with no barriers at all; a worker
+ * takes the next job off a shared counter when it finishes one, so long
+ * and short boards even out. Every worker keeps its boards between jobs
+ * and only grows them, so after the first few jobs nothing is allocated.
+ */
+
+/* Appends one path to the job list, growing it as needed */
+static void batch_add(struct gol_batch *batch, int *cap, const char *path){
+    if(batch->num_paths == *cap){
+        *cap = *cap > 0 ? *cap * 2 : 64;
+        batch->paths = realloc(batch->paths, sizeof(char*) * *cap);
+        if(batch->paths == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    batch->paths[batch->num_paths] = strdup(path);
+    if(batch->paths[batch->num_paths] == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    batch->num_paths++;
+}
+
+static int batch_compare(const void *a, const void *b){
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* This function builds the job list: every regular file in arg, in name
+ * order, if it is a directory, or else every line of arg, which is a list
+ * of paths (blank lines and lines starting with # are skipped).
+ * batch: the batch to fill in
+ * arg: the directory or list file
+ * returns: none */
+void batch_read_list(struct gol_batch *batch, const char *arg){
+    struct stat st;
+    int cap = 0;
+
+    batch->paths = NULL;
+    batch->num_paths = 0;
+    if(stat(arg, &st) != 0){
+        printf("Error unable to open file %s\n", arg);
+        exit(1);
+    }
+    if(S_ISDIR(st.st_mode)){
+        DIR *dir = opendir(arg);
+        struct dirent *entry;
+        char *path = NULL;
+        size_t path_len = 0;
+        if(dir == NULL){
+            printf("Error unable to open directory %s\n", arg);
+            exit(1);
+        }
+        while((entry = readdir(dir)) != NULL){
+            size_t len = strlen(arg) + strlen(entry->d_name) + 2;
+            if(entry->d_name[0] == '.'){
+                continue;
+            }
+            if(len > path_len){
+                path_len = len;
+                path = realloc(path, path_len);
+                if(path == NULL){
+                    printf("ERROR: malloc failed!\n");
+                    exit(1);
+                }
+            }
+            snprintf(path, path_len, "%s/%s", arg, entry->d_name);
+            if(stat(path, &st) == 0 && S_ISREG(st.st_mode)){
+                batch_add(batch, &cap, path);
+            }
+        }
+        closedir(dir);
+        free(path);
+        qsort(batch->paths, batch->num_paths, sizeof(char*), batch_compare);
+        return;
+    }
+    FILE *list = fopen(arg, "r");
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    if(list == NULL){
+        printf("Error unable to open file %s\n", arg);
+        exit(1);
+    }
+    while((len = getline(&line, &line_cap, list)) >= 0){
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'
+                    || line[len - 1] == ' ' || line[len - 1] == '\t')){
+            line[--len] = '\0';
+        }
+        if(len == 0 || line[0] == '#'){
+            continue;
+        }
+        batch_add(batch, &cap, line);
+    }
+    free(line);
+    fclose(list);
+}
+
+/* Makes sure *buf holds at least need elements of size bytes, reallocating
+ * it (without keeping its contents) if not; returns 1 if it did */
+static int batch_reserve(void **buf, size_t *have, size_t need, size_t size){
+    if(need <= *have){
+        return 0;
+    }
+    // at least double, so a batch of growing boards reallocates rarely
+    if(need < *have * 2){
+        need = *have * 2;
+    }
+    free(*buf);
+    *buf = malloc(need * size);
+    if(*buf == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    *have = need;
+    return 1;
+}
+
+/* This function sets up the worker's boards for a rows x cols board that
+ * open_input() has just read the header of: it grows them if they are too
+ * small and clears the part of them the board uses.
+ * worker: the worker about to run the board
+ * returns: none */
+void batch_boards(struct gol_batch_worker *worker){
+    struct gol_data *data = &worker->data;
+    int rows = data->rows;
+    int cols = data->cols;
+
+    data->stride = cols + 2;
+    data->words_per_row = (cols + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    if(cols % BITS_PER_WORD == 0){
+        data->last_mask = ~(uint64_t)0;
+    }else{
+        data->last_mask = ((uint64_t)1 << (cols % BITS_PER_WORD)) - 1;
+    }
+    if(data->engine == ENGINE_BITPACK){
+        size_t words = (size_t)rows * data->words_per_row;
+        size_t have = worker->words;
+        worker->allocs += batch_reserve((void**)&worker->bcurrent, &have, words, sizeof(uint64_t));
+        have = worker->words;
+        worker->allocs += batch_reserve((void**)&worker->bnext, &have, words, sizeof(uint64_t));
+        worker->words = have;
+        if(batch_reserve((void**)&worker->bzero, &worker->zero_words, data->words_per_row,
+                    sizeof(uint64_t))){
+            worker->allocs++;
+            memset(worker->bzero, 0, worker->zero_words * sizeof(uint64_t));
+        }
+        // every word of next is written before it is read
+        memset(worker->bcurrent, 0, words * sizeof(uint64_t));
+        data->bcurrent = worker->bcurrent;
+        data->bnext = worker->bnext;
+        data->bzero = worker->bzero;
+    }else{
+        size_t cells = (size_t)(rows + 2) * (cols + 2);
+        size_t have = worker->cells;
+        worker->allocs += batch_reserve((void**)&worker->current, &have, cells, sizeof(int));
+        have = worker->cells;
+        worker->allocs += batch_reserve((void**)&worker->next, &have, cells, sizeof(int));
+        worker->cells = have;
+        // the halo of next is only zero if it was cleared, for a bounded world
+        memset(worker->current, 0, cells * sizeof(int));
+        memset(worker->next, 0, cells * sizeof(int));
+        data->current = worker->current;
+        data->next = worker->next;
+    }
+}
+
+/* This function runs one board of the batch to its last generation on the
+ * calling worker's boards.
+ * worker: the worker running it
+ * job: index of the board in the batch
+ * returns: none */
+void batch_job(struct gol_batch_worker *worker, int job){
+    struct gol_batch *batch = worker->batch;
+    struct gol_batch_result *result = &batch->results[job];
+    struct gol_data *data = &worker->data;
+    const char *path = batch->paths[job];
+    struct gol_input input;
+    double start = timing_now();
+
+    data->generation0 = 0;
+    open_input(data, path, &input);
+    if(batch->iters >= 0){
+        data->iters = batch->iters;
+    }
+    if(data->iters < 0){
+        printf("Error: %s has no round count, pass --iters N\n", path);
+        exit(1);
+    }
+    if(data->rows <= 0 || data->cols <= 0 || data->num_alive_cells < 0){
+        printf("Error: improper file format in %s.\n", path);
+        exit(1);
+    }
+    data->rounds = data->iters - data->generation0 > 0 ? data->iters - data->generation0 : 0;
+    data->cycles = batch->max_period > 0 ? &worker->cycles : NULL;
+    batch_boards(worker);
+    read_cells(data, &input);
+    close_input(data, &input);
+    if(data->engine == ENGINE_DENSE){
+        refresh_halo(data, data->current);
+    }
+    if(data->cycles != NULL){
+        cycles_start(data, data->cycles);
+    }
+    result->load = timing_now() - start;
+
+    start = timing_now();
+    int last_col = data->engine == ENGINE_BITPACK ? data->words_per_row - 1 : data->cols - 1;
+    long long live = data->num_alive_cells;
+    int a;
+    for(a = 0; a < data->rounds; a++){
+        live = step_tile(data, 0, data->rows - 1, 0, last_col);
+        int *temp = data->current;
+        data->current = data->next;
+        data->next = temp;
+        uint64_t *btemp = data->bcurrent;
+        data->bcurrent = data->bnext;
+        data->bnext = btemp;
+        if(data->engine == ENGINE_DENSE){
+            refresh_halo(data, data->current);
+        }
+        if(data->cycles != NULL){
+            data->cycles->hash ^= worker->counter.hash;
+            worker->counter.hash = 0;
+            if(cycles_record(data->cycles, data->generation0 + a + 1, live)){
+                a++;
+                break;
+            }
+        }
+    }
+    result->run = timing_now() - start;
+    result->rows = data->rows;
+    result->cols = data->cols;
+    result->generations = a;
+    result->population = live;
+    result->stable_gen = -1;
+    result->period = 0;
+    if(data->cycles != NULL && data->cycles->stable_gen >= 0){
+        result->stable_gen = data->cycles->stable_gen;
+        result->period = data->cycles->period;
+        result->population = cycles_population(data->cycles, data->iters);
+    }
+}
+
+/* A worker thread: runs jobs until there are none left */
+static void* batch_worker(void *arg){
+    struct gol_batch_worker *worker = arg;
+    struct gol_batch *batch = worker->batch;
+    int job;
+
+    pin_thread(worker->id);
+    worker->data.live_counts = &worker->counter;
+    if(batch->max_period > 0){
+        worker->cycles.max_period = batch->max_period;
+        worker->cycles.hashes = malloc(sizeof(uint64_t) * (batch->max_period + 1));
+        worker->cycles.pops = malloc(sizeof(long long) * (batch->max_period + 1));
+        if(worker->cycles.hashes == NULL || worker->cycles.pops == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    while((job = __atomic_fetch_add(&batch->next_job, 1, __ATOMIC_RELAXED)) < batch->num_paths){
+        batch_job(worker, job);
+    }
+    return NULL;
+}
+
+/* This function is the --batch mode: it runs every board named by
+ * argv[2] (a directory, or a file with one path per line) on its own, on
+ * a pool of worker threads, and prints each board's final population and
+ * timing in list order, then the totals.
+ *   --batch-threads N     worker threads, default the number of online CPUs
+ *   --batch-csv FILE      also write every board's result to FILE as CSV
+ *   --engine dense|bitpack  the engine every board runs with (default
+ *                         bitpack)
+ *   --iters N             run N rounds of every board, whatever its file
+ *                         says (RLE files need this)
+ *   --world torus|bounded
+ *   --rule RULE           as for a single board
+ *   --detect-cycles [--max-period N]  stop each board once it stabilizes;
+ *                         its population is still the one after all
+ *                         the rounds
+ * argc, argv: the command line, with --batch at argv[1]
+ * returns: 0 */
+int run_batch(int argc, char **argv){
+    struct gol_batch batch;
+    struct gol_batch_worker *workers;
+    int num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *csv_path = NULL;
+    FILE *csv = NULL;
+    struct gol_data *proto = &batch.proto;
+    int detect_cycles = 0, max_period = CYCLE_DEFAULT_PERIOD;
+
+    if(argc < 3){
+        printf("Usage: %s --batch <list_file|directory> [--batch-threads N] [--batch-csv FILE] [--engine dense|bitpack] [--iters N] [--world torus|bounded] [--rule RULE] [--detect-cycles [--max-period N]]\n", argv[0]);
+        exit(1);
+    }
+    memset(&batch, 0, sizeof(batch));
+    batch.iters = -1;
+    proto->engine = ENGINE_BITPACK;
+    proto->simd = SIMD_AUTO;
+    proto->world = WORLD_TORUS;
+    proto->output_mode = OUTPUT_NONE;
+    proto->num_threads = 1;
+    proto->rule_birth = RULE_MASK(3);
+    proto->rule_survive = RULE_MASK(2) | RULE_MASK(3);
+    for(int i = 3; i < argc; i++){
+        if(strcmp(argv[i], "--batch-threads") == 0 && i + 1 < argc){
+            num_workers = atoi(argv[++i]);
+            if(num_workers < 1){
+                printf("Error: --batch-threads must be at least 1\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--batch-csv") == 0 && i + 1 < argc){
+            csv_path = argv[++i];
+        }else if(strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "dense") == 0){
+                proto->engine = ENGINE_DENSE;
+            }else if(strcmp(argv[i], "bitpack") == 0){
+                proto->engine = ENGINE_BITPACK;
+            }else{
+                printf("Error: --batch runs the dense or bitpack engine, not %s\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--iters") == 0 && i + 1 < argc){
+            batch.iters = atoi(argv[++i]);
+            if(batch.iters < 0){
+                printf("Error: --iters must not be negative\n");
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--world") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "torus") == 0){
+                proto->world = WORLD_TORUS;
+            }else if(strcmp(argv[i], "bounded") == 0){
+                proto->world = WORLD_BOUNDED;
+            }else{
+                printf("Error: unknown world %s (use torus or bounded)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rule") == 0 && i + 1 < argc){
+            i++;
+            if(parse_rule(argv[i], &proto->rule_birth, &proto->rule_survive) != 0){
+                printf("Error: bad rule %s (use B/S notation, like B36/S23)\n", argv[i]);
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--detect-cycles") == 0){
+            detect_cycles = 1;
+        }else if(strcmp(argv[i], "--max-period") == 0 && i + 1 < argc){
+            max_period = atoi(argv[++i]);
+            if(max_period < 1){
+                printf("Error: --max-period must be at least 1\n");
+                exit(1);
+            }
+        }else{
+            printf("Error: unknown option %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    batch.max_period = detect_cycles ? max_period : 0;
+    for(int k = 0; k <= 8; k++){
+        proto->rule_next[0][k] = (proto->rule_birth >> k) & 1;
+        proto->rule_next[1][k] = (proto->rule_survive >> k) & 1;
+    }
+    if(proto->engine == ENGINE_BITPACK){
+        select_bitpack_kernel(proto);
+    }
+
+    batch_read_list(&batch, argv[2]);
+    if(batch.num_paths == 0){
+        printf("Error: no boards in %s\n", argv[2]);
+        exit(1);
+    }
+    if(num_workers > batch.num_paths){
+        num_workers = batch.num_paths;
+    }
+    batch.results = calloc(batch.num_paths, sizeof(struct gol_batch_result));
+    workers = calloc(num_workers, sizeof(struct gol_batch_worker));
+    if(batch.results == NULL || workers == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+
+    double start = timing_now();
+    for(int i = 0; i < num_workers; i++){
+        workers[i].batch = &batch;
+        workers[i].id = i;
+        workers[i].data = batch.proto;
+        if(pthread_create(&workers[i].thread, NULL, batch_worker, &workers[i]) != 0){
+            printf("Error: unable to create thread %d\n", i);
+            exit(1);
+        }
+    }
+    for(int i = 0; i < num_workers; i++){
+        pthread_join(workers[i].thread, NULL);
+    }
+    double wall = timing_now() - start;
+
+    if(csv_path != NULL){
+        csv = fopen(csv_path, "w");
+        if(csv == NULL){
+            printf("Error unable to open file %s\n", csv_path);
+            exit(1);
+        }
+        fprintf(csv, "board,rows,cols,generations,population,stable_generation,period,"
+                "load_secs,run_secs\n");
+    }
+    long long updates = 0, allocs = 0;
+    double busy = 0;
+    printf("%-32s %6s %6s %8s %10s %8s %6s %10s %10s\n", "board", "rows", "cols", "gens",
+            "population", "stable", "period", "load(s)", "run(s)");
+    for(int j = 0; j < batch.num_paths; j++){
+        struct gol_batch_result *result = &batch.results[j];
+        printf("%-32s %6d %6d %8lld %10lld %8lld %6d %10.6f %10.6f\n", batch.paths[j],
+                result->rows, result->cols, result->generations, result->population,
+                result->stable_gen, result->period, result->load, result->run);
+        if(csv != NULL){
+            fprintf(csv, "%s,%d,%d,%lld,%lld,%lld,%d,%.9f,%.9f\n", batch.paths[j], result->rows,
+                    result->cols, result->generations, result->population, result->stable_gen,
+                    result->period, result->load, result->run);
+        }
+        updates += (long long)result->rows * result->cols * result->generations;
+        busy += result->load + result->run;
+    }
+    for(int i = 0; i < num_workers; i++){
+        allocs += workers[i].allocs;
+    }
+    printf("batch: %d boards on %d threads in %.6f s (%.6f s of board time), "
+            "%.4g cell updates/s, %lld board allocations\n", batch.num_paths, num_workers,
+            wall, busy, wall > 0 ? updates / wall : 0, allocs);
+    if(csv != NULL){
+        fclose(csv);
+    }
+
+    for(int i = 0; i < num_workers; i++){
+        free(workers[i].current);
+        free(workers[i].next);
+        free(workers[i].bcurrent);
+        free(workers[i].bnext);
+        free(workers[i].bzero);
+        free(workers[i].cycles.hashes);
+        free(workers[i].cycles.pops);
+    }
+    for(int j = 0; j < batch.num_paths; j++){
+        free(batch.paths[j]);
+    }
+    free(batch.paths);
+    free(batch.results);
+    free(workers);
+    return 0;
+}
+
+/* helper function to initialize the array that makes up the board
+ * arr: is the array of type int
+ * rows: the number of rows in the file
+ * cols: the number of columns in the file
+ * returns: none */
+void make_board(int *arr, int rows, int cols){
+    int i, j;
+    for(i = 0; i < rows; i++){
+        for(j = 0; j < cols; j++){
+            arr[i*cols + j] = 0;
+        }
+    }
+}
+
+/* This function fills the halo of a dense board. In a torus world each
+ * halo cell gets a copy of the cell on the opposite edge (corners included),
+ * so the kernel sees wrapped neighbors without any modulo. In a bounded
+ * world the halo was zeroed by make_board() and is never written, so there
+ * is nothing to do.
+ * data: the struct of type struct gol_data
+ * board: the padded board (data->current or data->next) to refresh
+ * returns: none */
+void refresh_halo(struct gol_data *data, int *board){
+    int rows = data->rows;
+    int cols = data->cols;
+    int stride = data->stride;
+    if(data->world != WORLD_TORUS){
+        return;
+    }
+    for(int i = 1; i <= rows; i++){
+        board[i*stride] = board[i*stride + cols];
+        board[i*stride + cols + 1] = board[i*stride + 1];
+    }
+    // whole padded rows, so the corners come along with the edges
+    memcpy(board, board + rows*stride, sizeof(int) * stride);
+    memcpy(board + (rows + 1)*stride, board + stride, sizeof(int) * stride);
+}
+
+void* play_gol_thread(void* arg){
+    //Unpack the arguments that are passed into the thread
+    struct gol_data *data;
+    data = (struct gol_data*) arg;
+    int id = data->id;
+    int start_row = 0;
+    int end_row = data->rows - 1;
+    int start_col = 0;
+    int end_col = data->cols - 1;
+    if(data->engine == ENGINE_BITPACK){
+        end_col = data->words_per_row - 1;
+    }
+    if(data->para_mode ==0){
+        start_row= data->row_partition_info[id][0];
+        end_row = data->row_partition_info[id][1];
+    }else if(data->para_mode == 1){
+        start_col= data->col_partition_info[id][0];
+        end_col = data->col_partition_info[id][1];
+    }else if(data->para_mode == PARA_TILES){
+        start_row = data->tile_partition_info[id][0];
+        end_row = data->tile_partition_info[id][1];
+        start_col = data->tile_partition_info[id][2];
+        end_col = data->tile_partition_info[id][3];
+    }
+     
+    // printf("Starting Row: %d\n",start_row);
+    // printf("Ending Row: %d\n",end_row);
+    // printf("Starting Col: %d\n",start_col);
+    // printf("Ending Col: %d\n",end_col);
+    //could call outside of this function
+    //assume that we're focusing on rows
+    if(data->print_info ==1 && data->para_mode != PARA_STEAL){
+    printf("tid %d: rows: %d:%d (%d) cols: %d:%d (%d)\n", id, start_row, end_row, end_row-start_row+1, start_col, end_col, end_col - start_col +1);
+    }   
+
+    //in para_mode 2 every thread moves to its own core and zeroes its own
+    //block before anything else touches it. A --random board is made the
+    //same way, in every mode, by the threads that compute it; in para_mode
+    //3, which has no blocks, each thread fills a strip of rows.
+    double fill_start = timing_now();
+    if(data->para_mode == PARA_TILES || data->random_fill){
+        if(data->para_mode == PARA_TILES){
+            pin_thread(id);
+        }
+        if(data->random_fill && data->para_mode == PARA_STEAL){
+            data->live_counts[id].live = random_fill(data,
+                    (int)((long long)data->rows * id / data->num_threads),
+                    (int)((long long)data->rows * (id + 1) / data->num_threads) - 1,
+                    start_col, end_col);
+        }else if(data->random_fill){
+            data->live_counts[id].live = random_fill(data, start_row, end_row,
+                    start_col, end_col);
+        }else{
+            first_touch(data, start_row, end_row, start_col, end_col);
+        }
+        barrier_wait(data->barrier, &data->barrier_sense);
+    }
+    if(id == 0){
+        if(data->random_fill){
+            if(data->engine == ENGINE_DENSE){
+                refresh_halo(data, data->current);
+            }
+            //the generation 0 live count, and its --population line; making
+            //the board counts as loading it
+            reduce_live_counts(data, data->generation0);
+            data->timing->load += timing_now() - fill_start;
+        }
+        if(data->initial_cells != NULL){
+            place_initial_cells(data);
+        }
+        if(data->para_mode == PARA_STEAL){
+            fill_deques(data);
+        }
+        if(data->cycles != NULL){
+            cycles_start(data, data->cycles);
+        }
+        /* ASCII output: clear screen & print the initial board */
+        if(data->render != NULL){
+            render_publish(data, data->generation0, 1);
+        }else if(data->output_mode == OUTPUT_ASCII){
+            print_board(data, data->generation0);
+        }else if(data->output_mode == OUTPUT_VISI){
+            //the whole board once; after this only changed cells are painted
+            update_colors(data);
+            draw_ready(data->handle);
+        }
+    }
+    barrier_wait(data->barrier, &data->barrier_sense);
+
+    //with print_info, time every phase of every generation
+    struct gol_thread_stats *stats = data->thread_stats != NULL ? &data->thread_stats[id] : NULL;
+    double phase = 0;
+    //the stats start out zeroed, and fd 0 is stdin, not a counter
+    if(stats != NULL){
+        stats->perf_fd = -1;
+    }
+    if(stats != NULL && data->perf){
+        perf_open(stats);
+    }
+
+    //--temporal: this thread's two scratch boards for the bands
+    uint64_t *scratch = NULL;
+    if(data->temporal != NULL){
+        size_t words = 2 * (size_t)(data->temporal->band_rows + 2 * data->temporal->k_max)
+            * data->words_per_row;
+        scratch = aligned_alloc(CACHE_LINE, (words * sizeof(uint64_t) + CACHE_LINE - 1)
+                / CACHE_LINE * CACHE_LINE);
+        if(scratch == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+
+    //Process the partition of the game board assigned to this thread
+    double gen_start = 0;
+    int step = 1;   // generations this pass advances: 1, or a --temporal block
+    for(int a = 0; a<data->rounds; a += step){
+        long long live = 0;
+        if(id == 0){
+            gen_start = timing_now();
+        }
+        if(stats != NULL){
+            phase = timing_now();
+        }
+        if(data->temporal != NULL){
+            //every thread works out the same depth: k is only changed by
+            //thread 0 between the barriers, and the rest is the same for all
+            step = data->temporal->k < data->rounds - a ? data->temporal->k : data->rounds - a;
+            if(data->checkpoint != NULL && data->checkpoint->every > 0){
+                long long gen = data->generation0 + a;
+                long long to_checkpoint = data->checkpoint->every - gen % data->checkpoint->every;
+                step = to_checkpoint < step ? to_checkpoint : step;
+            }
+            if(stats != NULL){
+                stats->cells += tile_cells(data, start_row, end_row, start_col, end_col) * step;
+            }
+            live = temporal_block(data, start_row, end_row, step, scratch);
+        }else if(data->para_mode == PARA_STEAL){
+            live = run_stealing(data, id);
+        }else{
+            //walk the partition one tile at a time (in the strip modes the
+            //tile is the whole partition)
+            for(int tr = start_row; tr <= end_row; tr += data->tile_rows){
+                int tr_end = tr + data->tile_rows - 1 < end_row ? tr + data->tile_rows - 1 : end_row;
+                for(int tc = start_col; tc <= end_col; tc += data->tile_cols){
+                    int tc_end = tc + data->tile_cols - 1 < end_col ? tc + data->tile_cols - 1 : end_col;
+                    live += step_tile(data, tr, tr_end, tc, tc_end);
+                }
+            }
+        }
+        data->live_counts[id].live = live;
+        if(stats != NULL){
+            double now = timing_now();
+            stats->compute += now - phase;
+            phase = now;
+        }
+        //Barrier to wait for all threads to finish writing next
+        barrier_wait(data->barrier, &data->barrier_sense);
+        if(stats != NULL){
+            double now = timing_now();
+            stats->wait += now - phase;
+            phase = now;
+        }
+
+        // replaces the current board with next board. Every thread has its
+        // own copy of the pointers and they all swap the same way.
+        int *temp = data->current;
+        data->current = data->next;
+        data->next = temp;
+        uint64_t *btemp = data->bcurrent;
+        data->bcurrent = data->bnext;
+        data->bnext = btemp;
+        unsigned char *ctemp = data->changed;
+        data->changed = data->changed_next;
+        data->changed_next = ctemp;
+
+        //the halo, the live count and the output are done once, by thread 0
+        if(id == 0){
+            long long generation = data->generation0 + a + step;
+            reduce_live_counts(data, generation);
+            if(data->engine == ENGINE_DENSE){
+                refresh_halo(data, data->current);
+            }
+            if(data->checkpoint != NULL){
+                checkpoint_maybe(data, generation);
+            }
+            if(data->cycles != NULL && cycles_record(data->cycles, generation, total_live)){
+                data->cycles->stop = 1;
+            }
+            if(data->para_mode == PARA_STEAL){
+                fill_deques(data);
+            }
+            if(data->active){
+                memset(data->changed_next, 0, (size_t)data->active_down * data->active_across);
+            }
+            double output_start = timing_now();
+            //a --temporal block counts as step generations of equal latency
+            for(int s = 0; s < step; s++){
+                latency_add(&data->timing->latency, (output_start - gen_start) / step);
+            }
+            data->timing->compute += output_start - gen_start;
+            if(data->temporal != NULL && data->temporal->tuning){
+                temporal_tune(data, step, output_start - gen_start);
+            }
+            //with --async-render the render thread draws, at its own pace
+            if(data->render != NULL){
+                render_publish(data, generation, 0);
+            }
+            //If the output_mode is 1 then the program runs the ASCII version
+            else if(data->output_mode == 1){
+                print_board(data, generation);
+                usleep(SLEEP_USECS);
+            }
+
+            //If output_mode is 2 then the program runs the animation version
+            else if(data->output_mode == 2){ 
+                if(!data->visi_dirty){
+                    update_colors(data);
+                }
+                draw_ready(data->handle);
+                usleep(SLEEP_USECS);
+            }
+            data->timing->output += timing_now() - output_start;
+        }
+        if(stats != NULL){
+            double now = timing_now();
+            stats->serial += now - phase;
+            phase = now;
+        }
+        //nobody reads current until its halo is ready
+        barrier_wait(data->barrier, &data->barrier_sense);
+        if(stats != NULL){
+            stats->wait += timing_now() - phase;
+        }
+        //a checkpoint claimed in the serial step: every thread packs its
+        //rows, and thread 0 hands it over once they all have
+        if(data->checkpoint != NULL && data->checkpoint->filling != NULL){
+            checkpoint_pack(data, id);
+            barrier_wait(data->barrier, &data->barrier_sense);
+            if(id == 0){
+                checkpoint_publish(data);
+            }
+        }
+        //every thread sees the same flag after the barrier, so they all
+        //stop at the same generation
+        if(data->cycles != NULL && data->cycles->stop){
+            break;
+        }
+    }
+    if(stats != NULL && data->perf){
+        perf_close(stats);
+    }
+    free(scratch);
+    //the render thread always gets the last generation
+    if(id == 0 && data->render != NULL){
+        render_publish(data, data->cycles != NULL && data->cycles->stop
+                ? data->cycles->generation : data->generation0 + data->rounds, 1);
+    }
+    if(data->print_info == 1 && data->para_mode == PARA_STEAL){
+        printf("tid %d: tiles: %lld steals: %lld\n", id,
+                data->live_counts[id].tiles, data->live_counts[id].steals);
+    }
+    return NULL;   
+    //pthread_exit(NULL);
+}
+
+/* This function sets up the barrier the threads meet at between
+ * generations.
+ * barrier: the barrier to set up
+ * kind: BARRIER_PTHREAD or BARRIER_SPIN
+ * num_threads: the number of threads that will wait at it
+ * returns: none */
+void barrier_init(struct gol_barrier *barrier, int kind, int num_threads){
+    barrier->kind = kind;
+    barrier->num_threads = num_threads;
+    barrier->count = num_threads;
+    barrier->sense = 0;
+    if(kind == BARRIER_PTHREAD){
+        if(pthread_barrier_init(&barrier->pbarrier, NULL, num_threads) != 0){
+            printf("ERROR: pthread_barrier_init failed!\n");
+            exit(1);
+        }
+    }
+}
+
+/* This function blocks until all the threads have called it. The spin
+ * barrier is sense-reversing: each thread flips its own sense on the way
+ * in, the last thread to arrive resets the count and publishes the new
+ * sense, and everybody else spins until they see it. Nothing has to be
+ * reset between uses, so the same barrier works for every generation.
+ * barrier: the barrier to wait at
+ * local_sense: the calling thread's sense, flipped on every call
+ * returns: none */
+void barrier_wait(struct gol_barrier *barrier, int *local_sense){
+    if(barrier->kind == BARRIER_PTHREAD){
+        pthread_barrier_wait(&barrier->pbarrier);
+        return;
+    }
+    int sense = !*local_sense;
+    *local_sense = sense;
+    if(__atomic_sub_fetch(&barrier->count, 1, __ATOMIC_ACQ_REL) == 0){
+        __atomic_store_n(&barrier->count, barrier->num_threads, __ATOMIC_RELAXED);
+        __atomic_store_n(&barrier->sense, sense, __ATOMIC_RELEASE);
+        return;
+    }
+    for(int spins = 1; __atomic_load_n(&barrier->sense, __ATOMIC_ACQUIRE) != sense; spins++){
+#ifdef HAVE_X86_SIMD
+        __builtin_ia32_pause();
+#endif
+        // more threads than cores: let the ones we are waiting for run
+        if(spins % SPIN_YIELD_EVERY == 0){
+            sched_yield();
+        }
+    }
+}
+
+/* This function adds up the live cells every thread counted in the
+ * generation that was just written into total_live, and appends it to the
+ * population series. Only thread 0 calls it, between the two barriers, so
+ * nothing else is touching the counters.
+ * data: the struct of type struct gol_data
+ * round: the generation the counts are for
+ * returns: none */
+void reduce_live_counts(struct gol_data *data, long long round){
+    long long live = 0;
+    long long old_live = 0;
+    long long skipped = 0;
+    for(int i = 0; i < data->num_threads; i++){
+        live += data->live_counts[i].live;
+        old_live += data->live_counts[i].old_live;
+        if(data->cycles != NULL){
+            data->cycles->hash ^= data->live_counts[i].hash;
+            data->live_counts[i].hash = 0;
+        }
+        skipped += data->live_counts[i].skipped;
+        data->live_counts[i].old_live = 0;
+        data->live_counts[i].skipped = 0;
+    }
+    //with --active only the computed tiles were counted; the first
+    //generation computes them all, after that apply the difference
+    if(data->active && round > data->generation0 + 1){
+        live = total_live + live - old_live;
+    }
+    total_live = live;
+    if(data->population_file != NULL){
+        if(data->active){
+            fprintf(data->population_file, "%lld %lld %lld\n", round, live, skipped);
+        }else{
+            fprintf(data->population_file, "%lld %lld\n", round, live);
+        }
+    }
+}
+
+/* This function releases whatever barrier_init() set up.
+ * barrier: the barrier to release
+ * returns: none */
+void barrier_destroy(struct gol_barrier *barrier){
+    if(barrier->kind == BARRIER_PTHREAD){
+        pthread_barrier_destroy(&barrier->pbarrier);
+    }
+}
+
+/* the gol application main loop function:
+ *  runs rounds of GOL,
+ *    * updates program state for next round (world and total_live)
+ *    * performs any animation step based on the output/run mode
+ *
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ */
+// void* play_gol(void* args) {
+//     struct gol_data *data;
+//     data = (struct gol_data*) args;
+//     //initializing local variables 
+//     int alive;
+//     int* temp = NULL; 
+    
+//     //Gives each thread the number of rows it reads
+//     printf("Before Math: %d\n",data->num_threads);
+//     data->rows_per_thread = data->rows / data->num_threads;
+//     rt = data->rows %data->num_threads;
+//     //LOCK
+//     pthread_mutex_lock(&mutex);
+//     data->start_row = sr_count;
+//     if(rt!=0){
+//         rt--;
+//         data->rows_per_thread ++;
+//     }
+//     for(int a = 0; a<data->rows_per_thread; a++){
+//         sr_count++;
+//     }
+//     pthread_mutex_unlock(&mutex);
+//     printf("%d\n", data->start_row);
+//     //UNLOCK
+//     /*
+
+
+//     // for-loop for the number of rounds of the games
+//     for(int z=1;z<(data->iters)+1;z++){
+//         total_live = 0; 
+//         for(int i=0;i<data->rows;i++){
+//             for(int j=0;j<data->cols;j++){
+//                 alive = count_alive(data,i,j);
+//                 make_alive(data,i,j, alive);
+//             }   
+//         }
+
+//         //Swaps the current with next board
+//         temp = data->current;
+//         data->current = data->next;
+//         data->next = temp;
+
+//         //If the output_mode is 1 then the program runs the ASCII version
+//         if(data->output_mode == 1){
+//             system("clear");
+//             print_board(data, z);
+//             usleep(SLEEP_USECS);
+//         }
+        
+//         //If output_mode is 2 then the program runs the animation version
+//         else if(data->output_mode == 2){ 
+//             update_colors(data);
+//             draw_ready(data->handle);
+//             usleep(SLEEP_USECS);
+//         } 
+//     }
+
+
+//     */
+
+//     return NULL;
+// }
+
+   
+/* This functions counts the alive neighbors around each individual cell.
+ * The board has a halo, so the eight neighbors are always in bounds and the
+ * sum is straight-line code.
+ * data: the struct of type struct gol_data
+ * x_axis: x coordinate of a cell
+ * y_axis: y coordinate of a cell
+ * returns: alive, is of type int, and the number of alive cells*/
+int count_alive(struct gol_data *data, int x_axis, int y_axis){
+    int stride = data->stride;
+    const int *cell = data->current + (x_axis + 1)*stride + (y_axis + 1);
+
+    return cell[-stride - 1] + cell[-stride] + cell[-stride + 1]
+         + cell[-1]                          + cell[1]
+         + cell[stride - 1]  + cell[stride]  + cell[stride + 1];
+}
+
+/* This function determines whether a cell changes status (dead or alive) based on its 
+   number of alive neighbors.
+
+ * data: the struct of type struct gol_data
+ * x_axis: x coordinate of a cell
+ * y_axis: y coordinate of a cell
+ * alive: of type int. number of alive cells
+ * returns: 1 if the cell is alive in the next generation, 0 if not */
+int make_alive(struct gol_data *data, int x_axis, int y_axis, int alive){
+    int idx = (x_axis + 1)*data->stride + (y_axis + 1);
+    // every cell of next is written, dead or alive, so nothing is left over
+    // from two rounds ago; the rule is a table lookup, the same few
+    // instructions for any rule
+    int state = data->rule_next[data->current[idx]][alive];
+
+    data->next[idx] = state;
+    return state;
+}
+
+/* This function computes the next generation of columns c0..c1 of one row
+ * of the dense board.
+ * data: the struct of type struct gol_data
+ * row: the row to advance
+ * c0, c1: first and last column of the row to advance
+ * returns: the number of live cells written to the next board */
+int dense_step_row(struct gol_data *data, int row, int c0, int c1){
+    int live = 0;
+    for(int j = c0; j <= c1; j++){
+        live += make_alive(data, row, j, count_alive(data, row, j));
+    }
+    return live;
+}
+/********************** HashLife engine **********************/
+/* The board as a hash-consed quadtree: every distinct square of cells is
+ * stored once, so a pattern that repeats in space or time costs nothing
+ * extra, and the future of each square is computed once and memoized in
+ * the node. The engine runs on an unbounded plane, so a pattern that would
+ * reach the edge of the rows x cols board keeps going past it.
+ */
+
+/* Returns the hash of a node with the given quadrants */
+static inline size_t hl_hash(struct hl_node *nw, struct hl_node *ne,
+        struct hl_node *sw, struct hl_node *se){
+    uint64_t h = (uintptr_t)nw;
+    h = h * 0x9e3779b97f4a7c15ULL + (uintptr_t)ne;
+    h = h * 0x9e3779b97f4a7c15ULL + (uintptr_t)sw;
+    h = h * 0x9e3779b97f4a7c15ULL + (uintptr_t)se;
+    return (size_t)(h ^ (h >> 29));
+}
+
+/* Takes a node off the free list, carving a new block when it is empty */
+static struct hl_node *hl_alloc(struct hl_universe *hl){
+    if(hl->free_list == NULL){
+        struct hl_node *block = malloc(sizeof(struct hl_node) * HL_BLOCK_NODES);
+        struct hl_node **blocks = realloc(hl->blocks, sizeof(struct hl_node*) * (hl->num_blocks + 1));
+        if(block == NULL || blocks == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+        hl->blocks = blocks;
+        hl->blocks[hl->num_blocks++] = block;
+        for(int i = 0; i < HL_BLOCK_NODES; i++){
+            block[i].next = hl->free_list;
+            hl->free_list = &block[i];
+        }
+    }
+    struct hl_node *node = hl->free_list;
+    hl->free_list = node->next;
+    return node;
+}
+
+/* Doubles the hash table once it holds as many nodes as it has buckets */
+static void hl_rehash(struct hl_universe *hl){
+    size_t size = hl->table_size * 2;
+    struct hl_node **table = calloc(size, sizeof(struct hl_node*));
+    if(table == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    for(size_t b = 0; b < hl->table_size; b++){
+        struct hl_node *node = hl->table[b];
+        while(node != NULL){
+            struct hl_node *next = node->next;
+            size_t h = hl_hash(node->nw, node->ne, node->sw, node->se) & (size - 1);
+            node->next = table[h];
+            table[h] = node;
+            node = next;
+        }
+    }
+    free(hl->table);
+    hl->table = table;
+    hl->table_size = size;
+}
+
+/* Returns the one node with these four quadrants, making it if needed */
+static struct hl_node *hl_find(struct hl_universe *hl, struct hl_node *nw,
+        struct hl_node *ne, struct hl_node *sw, struct hl_node *se){
+    size_t h = hl_hash(nw, ne, sw, se) & (hl->table_size - 1);
+    for(struct hl_node *node = hl->table[h]; node != NULL; node = node->next){
+        if(node->nw == nw && node->ne == ne && node->sw == sw && node->se == se){
+            return node;
+        }
+    }
+    struct hl_node *node = hl_alloc(hl);
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->result = NULL;
+    node->pop = nw->pop + ne->pop + sw->pop + se->pop;
+    node->level = nw->level + 1;
+    node->mark = 0;
+    node->next = hl->table[h];
+    hl->table[h] = node;
+    hl->count++;
+    if(hl->count > hl->table_size){
+        hl_rehash(hl);
+    }
+    return node;
+}
+
+/* Returns the all-dead node of the given level */
+static struct hl_node *hl_empty(struct hl_universe *hl, int level){
+    if(hl->empty[level] == NULL){
+        struct hl_node *e = level == 0 ? hl->leaf[0] : hl_empty(hl, level - 1);
+        hl->empty[level] = level == 0 ? e : hl_find(hl, e, e, e, e);
+    }
+    return hl->empty[level];
+}
+
+/* Returns the state of cell (r, c) of a node, counted from its top-left */
+static int hl_cell(struct hl_node *node, long long r, long long c){
+    while(node->level > 0){
+        long long half = 1LL << (node->level - 1);
+        if(node->pop == 0){
+            return 0;
+        }
+        if(r < half){
+            node = c < half ? node->nw : node->ne;
+        }else{
+            node = c < half ? node->sw : node->se;
+            r -= half;
+        }
+        if(c >= half){
+            c -= half;
+        }
+    }
+    return (int)node->pop;
+}
+
+/* The center 2x2 of a 4x4 node one generation later, by brute force */
+static struct hl_node *hl_base(struct hl_universe *hl, struct hl_node *node){
+    int cells[4][4];
+    struct hl_node *out[4];
+    for(int r = 0; r < 4; r++){
+        for(int c = 0; c < 4; c++){
+            cells[r][c] = hl_cell(node, r, c);
+        }
+    }
+    for(int k = 0; k < 4; k++){
+        int r = 1 + k / 2;
+        int c = 1 + k % 2;
+        int alive = cells[r-1][c-1] + cells[r-1][c] + cells[r-1][c+1]
+                  + cells[r][c-1]                   + cells[r][c+1]
+                  + cells[r+1][c-1] + cells[r+1][c] + cells[r+1][c+1];
+        out[k] = hl->leaf[hl->rule_next[cells[r][c]][alive]];
+    }
+    return hl_find(hl, out[0], out[1], out[2], out[3]);
+}
+
+/* The center half of a node, at the same generation */
+static struct hl_node *hl_center(struct hl_universe *hl, struct hl_node *node){
+    return hl_find(hl, node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+/* This function returns the center half of a node of level k >= 2,
+ * 2^min(step_log, k-2) generations later. The node is covered by nine
+ * overlapping half-size squares; each is advanced (or just centered, when
+ * the step is shorter than the most this level can do), the nine results
+ * are grouped into four squares, and those are advanced again. Results are
+ * memoized in the node for the current step_log.
+ * hl: the HashLife universe
+ * node: the node to advance
+ * returns: the node for the center half, later on */
+static struct hl_node *hl_result(struct hl_universe *hl, struct hl_node *node){
+    if(node->result != NULL){
+        return node->result;
+    }
+    int k = node->level;
+    struct hl_node *result;
+    if(node->pop == 0){
+        result = hl_empty(hl, k - 1);
+    }else if(k == 2){
+        result = hl_base(hl, node);
+    }else{
+        struct hl_node *nw = node->nw, *ne = node->ne, *sw = node->sw, *se = node->se;
+        struct hl_node *n[9] = {
+            nw, hl_find(hl, nw->ne, ne->nw, nw->se, ne->sw), ne,
+            hl_find(hl, nw->sw, nw->se, sw->nw, sw->ne),
+            hl_find(hl, nw->se, ne->sw, sw->ne, se->nw),
+            hl_find(hl, ne->sw, ne->se, se->nw, se->ne),
+            sw, hl_find(hl, sw->ne, se->nw, sw->se, se->sw), se,
+        };
+        int full = hl->step_log >= k - 2;
+        for(int i = 0; i < 9; i++){
+            n[i] = full ? hl_result(hl, n[i]) : hl_center(hl, n[i]);
+        }
+        result = hl_find(hl,
+                hl_result(hl, hl_find(hl, n[0], n[1], n[3], n[4])),
+                hl_result(hl, hl_find(hl, n[1], n[2], n[4], n[5])),
+                hl_result(hl, hl_find(hl, n[3], n[4], n[6], n[7])),
+                hl_result(hl, hl_find(hl, n[4], n[5], n[7], n[8])));
+    }
+    node->result = result;
+    return result;
+}
+
+/* Forgets every memoized result; they are only good for one step_log */
+static void hl_set_step(struct hl_universe *hl, int step_log){
+    if(hl->step_log == step_log){
+        return;
+    }
+    hl->step_log = step_log;
+    for(size_t b = 0; b < hl->table_size; b++){
+        for(struct hl_node *node = hl->table[b]; node != NULL; node = node->next){
+            node->result = NULL;
+        }
+    }
+}
+
+/* Puts an empty border around the root, doubling its size */
+static void hl_expand(struct hl_universe *hl){
+    struct hl_node *root = hl->root;
+    struct hl_node *e = hl_empty(hl, root->level - 1);
+    long long half = 1LL << (root->level - 1);
+    hl->root = hl_find(hl,
+            hl_find(hl, e, e, e, root->nw),
+            hl_find(hl, e, e, root->ne, e),
+            hl_find(hl, e, root->sw, e, e),
+            hl_find(hl, root->se, e, e, e));
+    hl->row0 -= half;
+    hl->col0 -= half;
+}
+
+/* Marks a node and everything under it as reachable */
+static void hl_mark(struct hl_node *node){
+    if(node->mark){
+        return;
+    }
+    node->mark = 1;
+    if(node->level > 0){
+        hl_mark(node->nw);
+        hl_mark(node->ne);
+        hl_mark(node->sw);
+        hl_mark(node->se);
+    }
+}
+
+/* This function frees every node the root can no longer reach. Memoized
+ * results survive if the node they point to does; the rest are dropped and
+ * recomputed if they are needed again. It only runs between steps, when
+ * the root and the empty nodes are the only nodes anything holds on to.
+ * hl: the HashLife universe
+ * returns: none */
+static void hl_collect(struct hl_universe *hl){
+    size_t before = hl->count;
+    hl_mark(hl->root);
+    for(int level = 0; level < HL_MAX_LEVEL; level++){
+        if(hl->empty[level] != NULL){
+            hl_mark(hl->empty[level]);
+        }
+    }
+    // free the unmarked nodes, and drop results pointing at them
+    for(size_t b = 0; b < hl->table_size; b++){
+        struct hl_node **link = &hl->table[b];
+        while(*link != NULL){
+            struct hl_node *node = *link;
+            if(node->mark){
+                if(node->result != NULL && !node->result->mark){
+                    node->result = NULL;
+                }
+                link = &node->next;
+            }else{
+                *link = node->next;
+                node->next = hl->free_list;
+                hl->free_list = node;
+                hl->count--;
+            }
+        }
+    }
+    for(size_t b = 0; b < hl->table_size; b++){
+        for(struct hl_node *node = hl->table[b]; node != NULL; node = node->next){
+            node->mark = 0;
+        }
+    }
+    hl->leaf[0]->mark = 0;
+    hl->leaf[1]->mark = 0;
+    hl->collections++;
+    hl->freed += before - hl->count;
+}
+
+/* This function advances the whole universe 2^step_log generations. The
+ * root is grown until the pattern sits in its center quarter and the root
+ * is big enough for the step; then nothing can move out of the root's
+ * center half, which is what hl_result() returns.
+ * hl: the HashLife universe
+ * step_log: log2 of the number of generations to advance
+ * returns: none */
+static void hl_advance(struct hl_universe *hl, int step_log){
+    hl_set_step(hl, step_log);
+    for(;;){
+        struct hl_node *root = hl->root;
+        long long inner = root->nw->se->se->pop + root->ne->sw->sw->pop
+                        + root->sw->ne->ne->pop + root->se->nw->nw->pop;
+        if(root->level >= step_log + 3 && inner == root->pop){
+            break;
+        }
+        hl_expand(hl);
+    }
+    long long quarter = 1LL << (hl->root->level - 2);
+    hl->root = hl_result(hl, hl->root);
+    hl->row0 += quarter;
+    hl->col0 += quarter;
+    if(hl->count > hl->max_nodes){
+        hl_collect(hl);
+    }
+}
+
+/* Builds the quadtree for the cells in cells[0..n), a list of row, col
+ * pairs inside the square of the given level at (row0, col0). The pairs
+ * are reordered in place, quicksort style, to split them into quadrants. */
+static struct hl_node *hl_build(struct hl_universe *hl, int *cells, long long n,
+        int level, long long row0, long long col0){
+    if(n == 0){
+        return hl_empty(hl, level);
+    }
+    if(level == 0){
+        return hl->leaf[1];
+    }
+    long long half = 1LL << (level - 1);
+    long long split[5];
+    split[0] = 0;
+    split[4] = n;
+    // rows first, then each half by column
+    for(int pass = 0; pass < 3; pass++){
+        long long lo = pass == 0 ? 0 : (pass == 1 ? 0 : split[2]);
+        long long hi = pass == 0 ? n : (pass == 1 ? split[2] : n);
+        int axis = pass == 0 ? 0 : 1;
+        long long mid = (axis == 0 ? row0 : col0) + half;
+        long long i = lo;
+        for(long long j = lo; j < hi; j++){
+            if(cells[2*j + axis] < mid){
+                int r = cells[2*i], c = cells[2*i + 1];
+                cells[2*i] = cells[2*j];
+                cells[2*i + 1] = cells[2*j + 1];
+                cells[2*j] = r;
+                cells[2*j + 1] = c;
+                i++;
+            }
+        }
+        split[pass == 0 ? 2 : (pass == 1 ? 1 : 3)] = i;
+    }
+    return hl_find(hl,
+            hl_build(hl, cells, split[1] - split[0], level - 1, row0, col0),
+            hl_build(hl, cells + 2*split[1], split[2] - split[1], level - 1, row0, col0 + half),
+            hl_build(hl, cells + 2*split[2], split[3] - split[2], level - 1, row0 + half, col0),
+            hl_build(hl, cells + 2*split[3], split[4] - split[3], level - 1, row0 + half, col0 + half));
+}
+
+/* This function sets up the HashLife universe with the live cells read by
+ * init_game_data_from_args(), with the board's top-left cell at (0, 0).
+ * data: the struct of type struct gol_data
+ * returns: none */
+void hashlife_init(struct gol_data *data){
+    struct hl_universe *hl = calloc(1, sizeof(struct hl_universe));
+    if(hl == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    hl->table_size = HL_MIN_TABLE;
+    hl->table = calloc(hl->table_size, sizeof(struct hl_node*));
+    hl->leaf[0] = calloc(1, sizeof(struct hl_node));
+    hl->leaf[1] = calloc(1, sizeof(struct hl_node));
+    if(hl->table == NULL || hl->leaf[0] == NULL || hl->leaf[1] == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    hl->leaf[1]->pop = 1;
+    hl->max_nodes = data->hl_max_nodes;
+    memcpy(hl->rule_next, data->rule_next, sizeof(hl->rule_next));
+    hl->step_log = -1;
+
+    int level = 3;
+    while((1LL << level) < data->rows || (1LL << level) < data->cols){
+        level++;
+    }
+    hl->root = hl_build(hl, data->initial_cells, data->num_alive_cells, level, 0, 0);
+    hl->row0 = 0;
+    hl->col0 = 0;
+    data->hl = hl;
+}
+
+/* This function runs the whole simulation with the HashLife engine: the
+ * rounds are split into their binary digits and the universe is advanced
+ * 2^j generations for each digit j that is set. Only the first and the
+ * last generation are drawn, inside the rows x cols window of the board.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void play_hashlife(struct gol_data *data){
+    struct hl_universe *hl = data->hl;
+
+    if(data->output_mode == OUTPUT_ASCII){
+        total_live = hl->root->pop;
+        print_board(data, data->generation0);
+    }
+    double start = timing_now();
+    for(int j = 0; j < 31; j++){
+        if((data->rounds >> j) & 1){
+            hl_advance(hl, j);
+        }
+    }
+    data->timing->compute = timing_now() - start;
+    total_live = hl->root->pop;
+    if(data->population_file != NULL){
+        fprintf(data->population_file, "%lld %lld\n", data->generation0 + data->rounds, total_live);
+    }
+    if(data->output_mode == OUTPUT_ASCII){
+        print_board(data, data->generation0 + data->rounds);
+    }else if(data->output_mode == OUTPUT_VISI){
+        update_colors(data);
+        draw_ready(data->handle);
+    }
+    if(data->print_info == 1){
+        printf("hashlife: %zu nodes, %d collections freed %zu nodes, root level %d\n",
+                hl->count, hl->collections, hl->freed, hl->root->level);
+    }
+}
+
+/* This function releases the HashLife universe.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void hashlife_free(struct gol_data *data){
+    struct hl_universe *hl = data->hl;
+    if(hl == NULL){
+        return;
+    }
+    for(int i = 0; i < hl->num_blocks; i++){
+        free(hl->blocks[i]);
+    }
+    free(hl->blocks);
+    free(hl->table);
+    free(hl->leaf[0]);
+    free(hl->leaf[1]);
+    free(hl);
+    data->hl = NULL;
+}
+
+/* Returns the state of cell (x_axis, y_axis) of the HashLife universe */
+static int hashlife_get_cell(struct gol_data *data, int x_axis, int y_axis){
+    struct hl_universe *hl = data->hl;
+    long long r = x_axis - hl->row0;
+    long long c = y_axis - hl->col0;
+    long long size = 1LL << hl->root->level;
+    if(r < 0 || c < 0 || r >= size || c >= size){
+        return 0;
+    }
+    return hl_cell(hl->root, r, c);
+}
+
+/********************** Sparse engine **********************/
+/* Only the live cells are stored, as a list of packed coordinates; each
+ * generation they scatter neighbor counts into an open-addressing hash
+ * table sized to the population, so a step costs time and memory in
+ * proportion to the live cells rather than to rows x cols.
+ */
+
+/* Packs a cell's coordinates into one key */
+static inline uint64_t sparse_key(int x, int y){
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+/* Adds delta to the count of the cell with this key, inserting it */
+static inline void sparse_add(struct sparse_world *sw, uint64_t key, unsigned char delta){
+    size_t mask = sw->table_cap - 1;
+    size_t h = (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 20) & mask;
+    while(sw->keys[h] != key){
+        if(sw->keys[h] == SPARSE_EMPTY){
+            sw->keys[h] = key;
+            sw->counts[h] = 0;
+            break;
+        }
+        h = (h + 1) & mask;
+    }
+    sw->counts[h] += delta;
+}
+
+/* Makes sure the count table has room for every cell near n live cells */
+static void sparse_reserve(struct sparse_world *sw, size_t n){
+    size_t want = SPARSE_MIN_TABLE;
+    // up to nine cells per live cell, kept under half full
+    while(want < 18 * n){
+        want *= 2;
+    }
+    if(want > sw->table_cap){
+        free(sw->keys);
+        free(sw->counts);
+        sw->table_cap = want;
+        sw->keys = malloc(sizeof(uint64_t) * want);
+        sw->counts = malloc(want);
+        if(sw->keys == NULL || sw->counts == NULL){
+            printf("ERROR: malloc failed!\n");
+            exit(1);
+        }
+    }
+    memset(sw->keys, 0xff, sizeof(uint64_t) * sw->table_cap);
+}
+
+/* Moves every key in the table that passes keep() into the live list */
+static void sparse_collect(struct sparse_world *sw, int rule){
+    size_t n = 0;
+    for(size_t h = 0; h < sw->table_cap; h++){
+        if(sw->keys[h] == SPARSE_EMPTY){
+            continue;
+        }
+        int alive = sw->counts[h] >> SPARSE_ALIVE_SHIFT;
+        int neighbors = sw->counts[h] & (SPARSE_ALIVE - 1);
+        if(!rule || sw->rule_next[alive][neighbors]){
+            if(n == sw->live_cap){
+                sw->live_cap = sw->live_cap ? sw->live_cap * 2 : SPARSE_MIN_TABLE;
+                sw->live = realloc(sw->live, sizeof(uint64_t) * sw->live_cap);
+                if(sw->live == NULL){
+                    printf("ERROR: malloc failed!\n");
+                    exit(1);
+                }
+            }
+            sw->live[n++] = sw->keys[h];
+        }
+    }
+    sw->num_live = n;
+    sw->sorted = 0;
+}
+
+/* This function sets up the sparse world with the live cells read by
+ * init_game_data_from_args(); cells listed twice are only kept once.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void sparse_init(struct gol_data *data){
+    struct sparse_world *sw = calloc(1, sizeof(struct sparse_world));
+    if(sw == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    memcpy(sw->rule_next, data->rule_next, sizeof(sw->rule_next));
+    sparse_reserve(sw, data->num_alive_cells);
+    for(long long i = 0; i < data->num_alive_cells; i++){
+        sparse_add(sw, sparse_key(data->initial_cells[2*i], data->initial_cells[2*i + 1]), 0);
+    }
+    sparse_collect(sw, 0);
+    data->sparse = sw;
+}
+
+/* This function computes the next generation of the sparse world. Every
+ * live cell marks itself alive and adds one to each of its eight
+ * neighbors (wrapped, or dropped past the edge of a bounded world); the
+ * cells whose counts pass B3/S23 are the next live list.
+ * data: the struct of type struct gol_data
+ * returns: the number of live cells in the next generation */
+long long sparse_step(struct gol_data *data){
+    struct sparse_world *sw = data->sparse;
+    int rows = data->rows;
+    int cols = data->cols;
+    int torus = data->world == WORLD_TORUS;
+
+    sparse_reserve(sw, sw->num_live);
+    for(size_t i = 0; i < sw->num_live; i++){
+        int x = (int)(sw->live[i] >> 32);
+        int y = (int)(uint32_t)sw->live[i];
+        int xs[3] = {x == 0 ? (torus ? rows - 1 : -1) : x - 1, x,
+                     x == rows - 1 ? (torus ? 0 : -1) : x + 1};
+        int ys[3] = {y == 0 ? (torus ? cols - 1 : -1) : y - 1, y,
+                     y == cols - 1 ? (torus ? 0 : -1) : y + 1};
+        for(int a = 0; a < 3; a++){
+            if(xs[a] < 0){
+                continue;
+            }
+            for(int b = 0; b < 3; b++){
+                if(ys[b] < 0){
+                    continue;
+                }
+                sparse_add(sw, sparse_key(xs[a], ys[b]),
+                        (a == 1 && b == 1) ? SPARSE_ALIVE : 1);
+            }
+        }
+    }
+    sparse_collect(sw, 1);
+    return sw->num_live;
+}
+
+/* Orders two packed cells, for qsort */
+static int sparse_compare(const void *a, const void *b){
+    uint64_t ka = *(const uint64_t*)a;
+    uint64_t kb = *(const uint64_t*)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/* Returns the state of cell (x_axis, y_axis) of the sparse world. The live
+ * list is sorted the first time a generation is looked at, then searched. */
+static int sparse_get_cell(struct gol_data *data, int x_axis, int y_axis){
+    struct sparse_world *sw = data->sparse;
+    uint64_t key = sparse_key(x_axis, y_axis);
+    if(!sw->sorted){
+        qsort(sw->live, sw->num_live, sizeof(uint64_t), sparse_compare);
+        sw->sorted = 1;
+    }
+    size_t lo = 0, hi = sw->num_live;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(sw->live[mid] < key){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo < sw->num_live && sw->live[lo] == key;
+}
+
+/* This function runs the whole simulation with the sparse engine, in the
+ * calling thread, drawing every generation like play_gol_thread() does.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void play_sparse(struct gol_data *data){
+    total_live = data->sparse->num_live;
+    if(data->render != NULL){
+        render_publish(data, data->generation0, 1);
+    }else if(data->output_mode == OUTPUT_ASCII){
+        print_board(data, data->generation0);
+    }
+    for(int a = 0; a < data->rounds; a++){
+        double start = timing_now();
+        total_live = sparse_step(data);
+        double output_start = timing_now();
+        latency_add(&data->timing->latency, output_start - start);
+        data->timing->compute += output_start - start;
+        if(data->population_file != NULL){
+            fprintf(data->population_file, "%lld %lld\n", data->generation0 + a + 1, total_live);
+        }
+        if(data->render != NULL){
+            render_publish(data, data->generation0 + a + 1, 0);
+        }else if(data->output_mode == OUTPUT_ASCII){
+            print_board(data, data->generation0 + a + 1);
+            usleep(SLEEP_USECS);
+        }else if(data->output_mode == OUTPUT_VISI){
+            update_colors(data);
+            draw_ready(data->handle);
+            usleep(SLEEP_USECS);
+        }
+        data->timing->output += timing_now() - output_start;
+    }
+    if(data->render != NULL){
+        render_publish(data, data->generation0 + data->rounds, 1);
+    }
+}
+
+/* This function releases the sparse world.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void sparse_free(struct gol_data *data){
+    struct sparse_world *sw = data->sparse;
+    if(sw == NULL){
+        return;
+    }
+    free(sw->live);
+    free(sw->keys);
+    free(sw->counts);
+    free(sw);
+    data->sparse = NULL;
+}
+
+/* This function returns the state of one cell of the current board,
+ * whichever engine is storing it.
+ * data: the struct of type struct gol_data
+ * x_axis: x coordinate of a cell
+ * y_axis: y coordinate of a cell
+ * returns: 1 if the cell is alive, 0 if it is dead */
+int get_cell(struct gol_data *data, int x_axis, int y_axis){
+    if(data->engine == ENGINE_HASHLIFE){
+        return hashlife_get_cell(data, x_axis, y_axis);
+    }
+    if(data->engine == ENGINE_SPARSE){
+        return sparse_get_cell(data, x_axis, y_axis);
+    }
+    if(data->engine == ENGINE_BITPACK){
+        uint64_t word = data->bcurrent[x_axis*data->words_per_row + y_axis/BITS_PER_WORD];
+        return (word >> (y_axis % BITS_PER_WORD)) & 1;
+    }
+    return data->current[(x_axis + 1)*data->stride + (y_axis + 1)] == 1;
+}
+
+/* Returns a word whose bit k holds the west neighbor (column - 1) of the
+ * cell in bit k of word w, wrapping column 0 around to the last column
+ * (or reading a dead cell there in a bounded world). */
+static inline uint64_t bitpack_west(struct gol_data *data, const uint64_t *row, int w){
+    uint64_t carry;
+    if(w > 0){
+        carry = row[w-1] >> (BITS_PER_WORD - 1);
+    }else if(data->world == WORLD_BOUNDED){
+        carry = 0;
+    }else{
+        carry = (row[data->words_per_row-1] >> ((data->cols - 1) % BITS_PER_WORD)) & 1;
+    }
+    return (row[w] << 1) | carry;
+}
+
+/* Returns a word whose bit k holds the east neighbor (column + 1) of the
+ * cell in bit k of word w, wrapping the last column around to column 0
+ * (or reading a dead cell there in a bounded world). */
+static inline uint64_t bitpack_east(struct gol_data *data, const uint64_t *row, int w){
+    if(w < data->words_per_row - 1){
+        return (row[w] >> 1) | (row[w+1] << (BITS_PER_WORD - 1));
+    }
+    if(data->world == WORLD_BOUNDED){
+        // the padding bits past the last column are always dead
+        return row[w] >> 1;
+    }
+    return (row[w] >> 1) | ((row[0] & 1) << ((data->cols - 1) % BITS_PER_WORD));
+}
+
+/* Sets NEXT to the cells of ALIVE (64 to a word, or a vector of words of
+ * type VTYPE) that live in the next generation under the Life-like rule
+ * with birth mask BIRTH and survival mask SURVIVE (bit k set: born /
+ * survives with k live neighbors). The eight neighbor words are summed
+ * bit-wise with full adders into a 4-bit count per cell, s3 s2 s1 s0,
+ * and each count k in the rule adds its cells: the ones where the count
+ * equals k, masked by dead cells for birth and live cells for survival.
+ * With constant masks the compiler folds away every count not in the
+ * rule, so B3/S23 comes out as the few operations it always was; with
+ * masks read at run time it is the same straight-line code for any rule. */
+#define BITPACK_EQ(K, S0, S1, S2) \
+    (((K) & 1 ? (S0) : ~(S0)) & ((K) & 2 ? (S1) : ~(S1)) & ((K) & 4 ? (S2) : ~(S2)))
+#define BITPACK_TERM(K, EQ, BIRTH, SURVIVE, LIVE, DEAD) \
+    ((EQ) & (((DEAD) & (uint64_t)-(uint64_t)(((BIRTH) >> (K)) & 1)) \
+           | ((LIVE) & (uint64_t)-(uint64_t)(((SURVIVE) >> (K)) & 1))))
+#define BITPACK_RULE(VTYPE, NEXT, NW, N, NE, W, ALIVE, E, SW, S, SE, BIRTH, SURVIVE) \
+    do {                                                                     \
+        /* ones and twos of the row above, the row below and the middle */   \
+        VTYPE u0_ = (NW) ^ (N) ^ (NE);                                       \
+        VTYPE u1_ = ((NW) & (N)) | ((NE) & ((NW) ^ (N)));                    \
+        VTYPE l0_ = (SW) ^ (S) ^ (SE);                                       \
+        VTYPE l1_ = ((SW) & (S)) | ((SE) & ((SW) ^ (S)));                    \
+        VTYPE m0_ = (W) ^ (E);                                               \
+        VTYPE m1_ = (W) & (E);                                               \
+        /* add the ones, carrying into the twos */                           \
+        VTYPE s0_ = u0_ ^ l0_ ^ m0_;                                         \
+        VTYPE c1_ = (u0_ & l0_) | (m0_ & (u0_ ^ l0_));                       \
+        /* add the four twos */                                              \
+        VTYPE x0_ = u1_ ^ l1_ ^ m1_;                                         \
+        VTYPE x1_ = (u1_ & l1_) | (m1_ & (u1_ ^ l1_));                       \
+        VTYPE s1_ = x0_ ^ c1_;                                               \
+        VTYPE s2_ = x1_ ^ (x0_ & c1_);                                       \
+        VTYPE s3_ = x1_ & x0_ & c1_;                                         \
+        VTYPE live_ = (ALIVE);                                               \
+        VTYPE dead_ = ~live_;                                                \
+        /* a count of 8 looks like 0 in the low three bits */                \
+        NEXT = BITPACK_TERM(0, BITPACK_EQ(0, s0_, s1_, s2_) & ~s3_,          \
+                    BIRTH, SURVIVE, live_, dead_)                            \
+             | BITPACK_TERM(1, BITPACK_EQ(1, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(2, BITPACK_EQ(2, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(3, BITPACK_EQ(3, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(4, BITPACK_EQ(4, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(5, BITPACK_EQ(5, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(6, BITPACK_EQ(6, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(7, BITPACK_EQ(7, s0_, s1_, s2_), BIRTH, SURVIVE, live_, dead_) \
+             | BITPACK_TERM(8, s3_, BIRTH, SURVIVE, live_, dead_);           \
+    } while(0)
+
+/* Applies the rule with masks birth and survive to 64 cells at once */
+static inline uint64_t bitpack_rule_word(uint64_t nw, uint64_t n, uint64_t ne,
+        uint64_t w, uint64_t alive, uint64_t e,
+        uint64_t sw, uint64_t s, uint64_t se, unsigned birth, unsigned survive){
+    uint64_t next;
+    BITPACK_RULE(uint64_t, next, nw, n, ne, w, alive, e, sw, s, se, birth, survive);
+    return next;
+}
+
+/* Defines a scalar row kernel for the rule BIRTH / SURVIVE: advances
+ * interior words w0..w1 (0 < w0, w1 < last word) of a bit-packed row,
+ * whose west/east neighbors are in the row. BIRTH and SURVIVE are
+ * constants for a specialized kernel, or the birth and survive arguments
+ * for the generic one. */
+#define DEFINE_BITPACK_SCALAR_KERNEL(NAME, BIRTH, SURVIVE)                   \
+static int NAME(const uint64_t *up, const uint64_t *mid,                     \
+        const uint64_t *down, uint64_t *out, int w0, int w1,                 \
+        unsigned birth, unsigned survive){                                   \
+    int live = 0;                                                            \
+    for(int w = w0; w <= w1; w++){                                           \
+        uint64_t next;                                                       \
+        BITPACK_RULE(uint64_t, next,                                         \
+                (up[w] << 1) | (up[w-1] >> 63), up[w], (up[w] >> 1) | (up[w+1] << 63), \
+                (mid[w] << 1) | (mid[w-1] >> 63), mid[w], (mid[w] >> 1) | (mid[w+1] << 63), \
+                (down[w] << 1) | (down[w-1] >> 63), down[w], (down[w] >> 1) | (down[w+1] << 63), \
+                BIRTH, SURVIVE);                                             \
+        out[w] = next;                                                       \
+        live += __builtin_popcountll(next);                                  \
+    }                                                                        \
+    return live;                                                             \
+}
+
+#ifdef HAVE_X86_SIMD
+/* Defines a SIMD row kernel that runs the same full-adder logic as
+ * BITPACK_RULE() on VTYPE, a vector of 64-bit words built for the
+ * instruction set TARGET. Neighbor words are unaligned loads at w-1 and
+ * w+1, so each lane gets its carry bits without any shuffles; the words
+ * left over at the end of the range go through the scalar kernel SCALAR
+ * for the same rule. */
+#define DEFINE_BITPACK_SIMD_KERNEL(NAME, TARGET, VTYPE, SCALAR, BIRTH, SURVIVE) \
+__attribute__((target(TARGET)))                                              \
+static int NAME(const uint64_t *up, const uint64_t *mid,                     \
+        const uint64_t *down, uint64_t *out, int w0, int w1,                 \
+        unsigned birth, unsigned survive){                                   \
+    const int lanes = sizeof(VTYPE) / sizeof(uint64_t);                      \
+    int live = 0;                                                            \
+    int w = w0;                                                              \
+    for(; w + lanes - 1 <= w1; w += lanes){                                  \
+        VTYPE a, b, c, nw, n, ne, wst, cur, est, sw, so, se;                 \
+        memcpy(&a, up + w - 1, sizeof a);                                    \
+        memcpy(&n, up + w, sizeof n);                                        \
+        memcpy(&c, up + w + 1, sizeof c);                                    \
+        nw = (n << 1) | (a >> 63);                                           \
+        ne = (n >> 1) | (c << 63);                                           \
+        memcpy(&a, mid + w - 1, sizeof a);                                   \
+        memcpy(&cur, mid + w, sizeof cur);                                   \
+        memcpy(&c, mid + w + 1, sizeof c);                                   \
+        wst = (cur << 1) | (a >> 63);                                        \
+        est = (cur >> 1) | (c << 63);                                        \
+        memcpy(&a, down + w - 1, sizeof a);                                  \
+        memcpy(&so, down + w, sizeof so);                                    \
+        memcpy(&c, down + w + 1, sizeof c);                                  \
+        sw = (so << 1) | (a >> 63);                                          \
+        se = (so >> 1) | (c << 63);                                          \
+        BITPACK_RULE(VTYPE, b, nw, n, ne, wst, cur, est, sw, so, se,         \
+                BIRTH, SURVIVE);                                             \
+        memcpy(out + w, &b, sizeof b);                                       \
+        for(int k = 0; k < lanes; k++){                                      \
+            live += __builtin_popcountll(out[w + k]);                        \
+        }                                                                    \
+    }                                                                        \
+    if(w <= w1){                                                             \
+        live += SCALAR(up, mid, down, out, w, w1, birth, survive);           \
+    }                                                                        \
+    return live;                                                             \
+}
+
+typedef uint64_t gol_u64x2 __attribute__((vector_size(16)));
+typedef uint64_t gol_u64x4 __attribute__((vector_size(32)));
+typedef uint64_t gol_u64x8 __attribute__((vector_size(64)));
+
+/* Every row kernel (scalar, sse2, avx2, avx512) for one rule */
+#define DEFINE_BITPACK_KERNELS(NAME, BIRTH, SURVIVE)                         \
+DEFINE_BITPACK_SCALAR_KERNEL(NAME##_scalar, BIRTH, SURVIVE)                  \
+DEFINE_BITPACK_SIMD_KERNEL(NAME##_sse2, "sse2", gol_u64x2, NAME##_scalar, BIRTH, SURVIVE) \
+DEFINE_BITPACK_SIMD_KERNEL(NAME##_avx2, "avx2", gol_u64x4, NAME##_scalar, BIRTH, SURVIVE) \
+DEFINE_BITPACK_SIMD_KERNEL(NAME##_avx512, "avx512f", gol_u64x8, NAME##_scalar, BIRTH, SURVIVE)
+#define BITPACK_KERNEL_SET(NAME) \
+    {NAME##_scalar, NAME##_sse2, NAME##_avx2, NAME##_avx512}
+#else
+#define DEFINE_BITPACK_KERNELS(NAME, BIRTH, SURVIVE)                         \
+DEFINE_BITPACK_SCALAR_KERNEL(NAME##_scalar, BIRTH, SURVIVE)
+#define BITPACK_KERNEL_SET(NAME) \
+    {NAME##_scalar, NAME##_scalar, NAME##_scalar, NAME##_scalar}
+#endif
+
+/* Kernels specialized for the rules that get run the most, with the rule
+ * compiled in, and the generic one that reads the masks at run time */
+DEFINE_BITPACK_KERNELS(bitpack_conway, RULE_MASK(3), RULE_MASK(2) | RULE_MASK(3))
+DEFINE_BITPACK_KERNELS(bitpack_highlife, RULE_MASK(3) | RULE_MASK(6), RULE_MASK(2) | RULE_MASK(3))
+DEFINE_BITPACK_KERNELS(bitpack_seeds, RULE_MASK(2), 0)
+DEFINE_BITPACK_KERNELS(bitpack_daynight,
+        RULE_MASK(3) | RULE_MASK(6) | RULE_MASK(7) | RULE_MASK(8),
+        RULE_MASK(3) | RULE_MASK(4) | RULE_MASK(6) | RULE_MASK(7) | RULE_MASK(8))
+DEFINE_BITPACK_KERNELS(bitpack_generic, birth, survive)
+
+/* The specialized kernels, by rule; anything else runs bitpack_generic */
+static const struct {
+    unsigned birth, survive;
+    bitpack_kernel_fn kernels[4];   // indexed by SIMD_SCALAR .. SIMD_AVX512
+} bitpack_rules[] = {
+    {RULE_MASK(3), RULE_MASK(2) | RULE_MASK(3), BITPACK_KERNEL_SET(bitpack_conway)},
+    {RULE_MASK(3) | RULE_MASK(6), RULE_MASK(2) | RULE_MASK(3), BITPACK_KERNEL_SET(bitpack_highlife)},
+    {RULE_MASK(2), 0, BITPACK_KERNEL_SET(bitpack_seeds)},
+    {RULE_MASK(3) | RULE_MASK(6) | RULE_MASK(7) | RULE_MASK(8),
+        RULE_MASK(3) | RULE_MASK(4) | RULE_MASK(6) | RULE_MASK(7) | RULE_MASK(8),
+        BITPACK_KERNEL_SET(bitpack_daynight)},
+};
+
+/* This function picks the row kernel used for the interior words of the
+ * bit-packed board: the one specialized for the rule if there is one,
+ * else the generic one. With --simd auto it takes the widest instruction
+ * set the CPU reports through CPUID; a requested kernel the CPU can't run
+ * falls back to the next narrower one.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void select_bitpack_kernel(struct gol_data *data){
+    static const bitpack_kernel_fn generic[4] = BITPACK_KERNEL_SET(bitpack_generic);
+    const bitpack_kernel_fn *kernels = generic;
+    int want = data->simd;
+    if(want == SIMD_AUTO){
+        want = SIMD_AVX512;
+    }
+    for(size_t i = 0; i < sizeof(bitpack_rules) / sizeof(bitpack_rules[0]); i++){
+        if(bitpack_rules[i].birth == data->rule_birth
+                && bitpack_rules[i].survive == data->rule_survive){
+            kernels = bitpack_rules[i].kernels;
+        }
+    }
+    data->simd = SIMD_SCALAR;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if(want >= SIMD_AVX512 && __builtin_cpu_supports("avx512f")){
+        data->simd = SIMD_AVX512;
+    }else if(want >= SIMD_AVX2 && __builtin_cpu_supports("avx2")){
+        data->simd = SIMD_AVX2;
+    }else if(want >= SIMD_SSE2 && __builtin_cpu_supports("sse2")){
+        data->simd = SIMD_SSE2;
+    }
+#endif
+    data->bitpack_kernel = kernels[data->simd];
+    if(data->print_info == 1){
+        static const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+        printf("bitpack kernel: %s, %s\n", names[data->simd],
+                kernels == generic ? "generic rule" : "specialized rule");
+    }
+}
+
+/* This function computes the next generation of words w0..w1 of one row
+ * of the bit-packed board.
+ * data: the struct of type struct gol_data
+ * row: the row to advance
+ * w0, w1: first and last word of the row to advance
+ * returns: the number of live cells written to the next board */
+int bitpack_step_row(struct gol_data *data, int row, int w0, int w1){
+    int wpr = data->words_per_row;
+    int rows = data->rows;
+    const uint64_t *up = data->bcurrent + (size_t)((row + rows - 1) % rows) * wpr;
+    const uint64_t *mid = data->bcurrent + (size_t)row * wpr;
+    const uint64_t *down = data->bcurrent + (size_t)((row + 1) % rows) * wpr;
+    if(data->world == WORLD_BOUNDED){
+        if(row == 0){
+            up = data->bzero;
+        }
+        if(row == rows - 1){
+            down = data->bzero;
+        }
+    }
+    return bitpack_step_words(data, up, mid, down, data->bnext + (size_t)row * wpr, w0, w1);
+}
+
+/* This function computes the next generation of words w0..w1 of the row
+ * mid, with up and down the rows above and below it, into out; the rows
+ * can be anywhere, on the board or in --temporal's scratch boards. The
+ * first and last word of the row wrap around to the other edge, so they
+ * are done here one at a time; everything in between goes through the row
+ * kernel picked by select_bitpack_kernel().
+ * data: the struct of type struct gol_data
+ * up, mid, down: the row and the rows above and below it
+ * out: where the next generation of the row goes
+ * w0, w1: first and last word of the row to advance
+ * returns: the number of live cells written to out */
+int bitpack_step_words(struct gol_data *data, const uint64_t *up, const uint64_t *mid,
+        const uint64_t *down, uint64_t *out, int w0, int w1){
+    int wpr = data->words_per_row;
+    int live = 0;
+    int w = w0;
+
+    // interior words: every word except the first and the last of the row
+    int first = w0 > 1 ? w0 : 1;
+    int last = w1 < wpr - 2 ? w1 : wpr - 2;
+
+    while(w <= w1){
+        if(w == first && first <= last){
+            live += data->bitpack_kernel(up, mid, down, out, first, last,
+                    data->rule_birth, data->rule_survive);
+            w = last + 1;
+            continue;
+        }
+        uint64_t next = bitpack_rule_word(
+                bitpack_west(data, up, w), up[w], bitpack_east(data, up, w),
+                bitpack_west(data, mid, w), mid[w], bitpack_east(data, mid, w),
+                bitpack_west(data, down, w), down[w], bitpack_east(data, down, w),
+                data->rule_birth, data->rule_survive);
+        // the bits past the last column are padding and must stay dead
+        if(w == wpr - 1){
+            next &= data->last_mask;
+        }
+        out[w] = next;
+        live += __builtin_popcountll(next);
+        w++;
+    }
+    return live;
+}
+
+/* This function updates the color od the cells in the VISI animation
+ * data: the struct of type struct gol_data
+ * returns: none */
+void update_colors(struct gol_data* data){
+  int i, j, r, c;
+    color3 *buff;
+
+    r = data->rows;
+    c = data->cols;
+
+    for (i = 0; i < r; i++) {
+        // the image is upside down: row i is pixel row r - (i+1)
+        buff = data->image_buff + (size_t)(r - (i+1))*c;
+        for (j = 0; j < c; j++) {
+            // update animation buffer
+            if (get_cell(data, i, j) == 0) {
+                buff[j] = c3_red;
+            } else {
+                buff[j] = c3_green;
+            }
+     
+        }
+    }
+
+}
+
+/* This function repaints only the pixels of the cells in a rectangle of
+ * the board that changed in the generation just computed into next, by
+ * comparing it with current (a word at a time, for bitpack). The worker
+ * that computed the rectangle calls it while the rows are still in its
+ * cache, so the repaint is split across the threads the same way the
+ * generation is, and a still board costs no pixel writes.
+ * data: the struct of type struct gol_data
+ * row0, row1: the first and last row of the rectangle
+ * col0, col1: the first and last column (word, for bitpack)
+ * returns: none */
+void paint_tile(struct gol_data *data, int row0, int row1, int col0, int col1){
+    int r = data->rows;
+    int c = data->cols;
+
+    for(int i = row0; i <= row1; i++){
+        color3 *buff = data->image_buff + (size_t)(r - (i+1))*c;
+        if(data->engine == ENGINE_BITPACK){
+            const uint64_t *cur = data->bcurrent + (size_t)i * data->words_per_row;
+            const uint64_t *out = data->bnext + (size_t)i * data->words_per_row;
+            for(int w = col0; w <= col1; w++){
+                uint64_t diff = cur[w] ^ out[w];
+                while(diff != 0){
+                    int b = __builtin_ctzll(diff);
+                    buff[w * BITS_PER_WORD + b] = (out[w] >> b) & 1 ? c3_green : c3_red;
+                    diff &= diff - 1;
+                }
+            }
+        }else{
+            const int *cur = data->current + (size_t)(i + 1) * data->stride + 1;
+            const int *out = data->next + (size_t)(i + 1) * data->stride + 1;
+            for(int j = col0; j <= col1; j++){
+                if(cur[j] != out[j]){
+                    buff[j] = out[j] ? c3_green : c3_red;
+                }
+            }
+        }
+    }
+}
+
+/* This function sets up the ASCII renderer: a frame buffer big enough
+ * for the whole board, and the cells that are on the screen now.
+ * data: the struct of type struct gol_data
+ * returns: none */
+void screen_init(struct gol_data *data){
+    struct gol_screen *screen = calloc(1, sizeof(struct gol_screen));
+    if(screen == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    // the board at 2 characters a cell, plus the round and live cell lines
+    screen->full_len = (size_t)data->rows * (2 * (size_t)data->cols + 1) + SCREEN_EXTRA;
+    screen->frame = malloc(screen->full_len);
+    screen->shown = calloc((size_t)data->rows * data->cols, 1);
+    if(screen->frame == NULL || screen->shown == NULL){
+        printf("ERROR: malloc failed!\n");
+        exit(1);
+    }
+    screen->drawn = 0;
+    data->screen = screen;
+}
+
+/* Frees the ASCII renderer, if there is one */
+void screen_free(struct gol_data *data){
+    if(data->screen == NULL){
+        return;
+    }
+    free(data->screen->frame);
+    free(data->screen->shown);
+    free(data->screen);
+    data->screen = NULL;
+}
+
+/* Writes all of buf to stderr, in one write() unless it comes up short */
+static void screen_write(const char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = write(STDERR_FILENO, buf, len);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/* This function builds the whole frame -- round, board and live cells --
+ * in the frame buffer, starting from the top left of the screen instead
+ * of clearing it, so the old frame is drawn over without flicker.
+ * data: the struct of type struct gol_data
+ * round: the generation on the board
+ * live: the live cells on the board
+ * returns: the length of the frame */
+static size_t screen_full_frame(struct gol_data *data, long long round, long long live){
+    struct gol_screen *screen = data->screen;
+    char *out = screen->frame;
+    unsigned char *shown = screen->shown;
+
+    // clear the screen the first time, after that just go to the top left
+    out += sprintf(out, "%sRound: %lld\x1b[K\n", screen->drawn ? "\x1b[H" : "\x1b[H\x1b[2J", round);
+    for(int i = 0; i < data->rows; i++){
+        for(int j = 0; j < data->cols; j++){
+            *shown = get_cell(data, i, j) != 0;
+            *out++ = ' ';
+            *out++ = *shown ? '@' : '.';
+            shown++;
+        }
+        *out++ = '\n';
+    }
+    out += sprintf(out, "Live cells: %lld\x1b[K\n\n\x1b[J", live);
+    return out - screen->frame;
+}
+
+/* This function builds a frame that only redraws the cells that changed
+ * since the last frame, each with an ANSI cursor move to it, plus the
+ * round and live cell lines. If that would come out longer than the whole
+ * frame, it gives up, so the caller can draw the whole frame instead.
+ * data: the struct of type struct gol_data
+ * round: the generation on the board
+ * live: the live cells on the board
+ * returns: the length of the frame, or 0 if it gave up */
+static size_t screen_diff_frame(struct gol_data *data, long long round, long long live){
+    struct gol_screen *screen = data->screen;
+    char *out = screen->frame;
+    char *end = screen->frame + screen->full_len - SCREEN_EXTRA;
+    unsigned char *shown = screen->shown;
+
+    out += sprintf(out, "\x1b[1;1HRound: %lld\x1b[K", round);
+    for(int i = 0; i < data->rows; i++){
+        for(int j = 0; j < data->cols; j++){
+            unsigned char alive = get_cell(data, i, j) != 0;
+            if(alive != *shown){
+                if(out + SCREEN_MOVE_LEN > end){
+                    return 0;
+                }
+                // the board starts on screen row 2, and a cell is " @"
+                out += sprintf(out, "\x1b[%d;%dH%c", i + 2, 2 * j + 2, alive ? '@' : '.');
+                *shown = alive;
+            }
+            shown++;
+        }
+    }
+    out += sprintf(out, "\x1b[%d;1HLive cells: %lld\x1b[K\x1b[%d;1H",
+            data->rows + 2, live, data->rows + 4);
+    return out - screen->frame;
+}
+
+/* This function prints the board to the terminal. The frame is built in
+ * one buffer and written with a single write(), drawing over the last
+ * frame with ANSI cursor moves; with --ascii-diff only the cells that
+ * changed since the last frame are drawn.
+ * data: the struct of type struct gol_data
+ * rounds: type int. Number of rounds 
+ * returns: none */
+void print_board(struct gol_data *data, long long round) {
+    draw_frame(data, round, total_live);
+}
+
+/* This function does the drawing for print_board(), with the live cell
+ * count passed in, so the render thread can draw a snapshot while
+ * total_live has moved on.
+ * data: the struct of type struct gol_data
+ * round: the generation on the board
+ * live: the live cells on the board
+ * returns: none */
+void draw_frame(struct gol_data *data, long long round, long long live){
+    struct gol_screen *screen = data->screen;
+    size_t len = 0;
+
+    if(data->ascii_diff && screen->drawn){
+        len = screen_diff_frame(data, round, live);
+    }
+    if(len == 0){
+        len = screen_full_frame(data, round, live);
+    }
+    screen->drawn = 1;
+    screen_write(screen->frame, len);
 }
 
 